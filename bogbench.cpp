@@ -0,0 +1,910 @@
+/******************************************************
+ * Benchmarks for BogglePlayer.
+ *
+ * Usage: bogbench lookup wordlist [-dawg]
+ *   Words per second through isInLexicon(), one at a time and
+ *   batched, on shuffled words and misses, and on long words
+ *   with shared prefixes.
+ *
+ * Usage: bogbench solve wordlist rows cols [boards] [-dawg] [-filter]
+ *                       [-j threads] [-stream | -paths | -isonboard]
+ *   Solves per second through setBoard() and getAllValidWords()
+ *   on random boards rolled from the standard dice; with -stream,
+ *   into a WordSink instead of a set, with the time to first word;
+ *   with -paths, into a WordPaths recording every word's path;
+ *   with -isonboard, into a set and then isOnBoard() for each word.
+ *
+ * Usage: bogbench steal wordlist board [-j threads]
+ *   How evenly a parallel solve keeps its threads busy, with
+ *   start cells only as tasks and with subtrees split off for
+ *   idle threads. board is a file in the brd.txt format, or
+ *   same:face:RxC for a board with every die showing face.
+ *
+ * Usage: bogbench onboard wordlist rows cols [boards]
+ *   Latency percentiles of isOnBoard(), into a buffer and into a
+ *   new vector, for the words on random boards mixed with as many
+ *   words from the lexicon, and the time to check each board's
+ *   whole list one word at a time and in one batch.
+ *
+ * Usage: bogbench strategy wordlist [boards]
+ *   Time per solve walking the board and scanning the lexicon,
+ *   for subsets of the word list on boards from 4x4 to 40x40,
+ *   next to the strategy AUTO_STRATEGY would pick.
+ *
+ * Usage: bogbench batch wordlist rows cols [boards] [-dawg]
+ *                       [-j threads] [-words]
+ *   Boards per second, and per thread, through solveBatch() on
+ *   random boards, next to setBoard() and getAllValidWords() one
+ *   board at a time, and how fast the boards load from text and
+ *   from a batch file.
+ *
+ * Usage: bogbench update wordlist rows cols [boards [changes]]
+ *                        [-dawg]
+ *   Time per change of one die through updateCell() and
+ *   getAllValidWords(), next to setBoard() and a full solve of
+ *   the changed board, and the time of the first change, which
+ *   builds the tree.
+ *
+ * Usage: bogbench cache wordlist rows cols [boards [solves]]
+ *                       [-dawg] [-size entries]
+ *   Time per solve through setBoard() and getAllValidWords() with
+ *   and without setResultCache(), for solves of boards drawn at
+ *   random, each turned or mirrored at random, from a pool of
+ *   random boards, with the hits and misses, and the time of a
+ *   hit alone. The cache holds the whole pool unless -size says
+ *   otherwise.
+ *
+ * Usage: bogbench anneal wordlist [seconds] [-dawg] [-j threads]
+ *                        [-chains chains] [-steps steps]
+ *   The best 4x4 boards annealBoards() finds in a time budget, with
+ *   the boards solved per second, next to the best of as many
+ *   seconds of random boards rolled as initRandomBoard() does.
+ *
+ * Usage: bogbench stats wordlist [samples] [-dawg] [-j threads]
+ *                       [-shuffle] [-seed seed]
+ *   The summary sampleBoards() gives of the words, scores and
+ *   longest words of random 4x4 boards, with the boards sampled
+ *   per second, next to setBoard() and getAllValidWords() on
+ *   boards rolled one at a time as strings.
+ * ****************************************************/
+
+#include "boggleplayer.h"
+#include "bogglegrid.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// counts words, and notes when the first one arrived
+class CountSink : public WordSink {
+public:
+  size_t count;
+  Clock::time_point first;
+  CountSink() : count(0) {}
+  void word(const char* data, unsigned int length,
+            const unsigned int* path, unsigned int cells) {
+    if(count++ == 0) first = Clock::now();
+  }
+};
+
+static bool readWords(const char* path, vector<string>& words) {
+  std::ifstream infile(path);
+  string word;
+  if(!infile.is_open()) return false;
+  while(std::getline(infile, word)) {
+    if(word.size() > 0) words.push_back(word);
+  }
+  return true;
+}
+
+static void timeLookups(BogglePlayer& p, const char* name,
+                        const vector<string>& words, int reps) {
+  vector<bool> hits;
+  Clock::time_point start;
+  double single, batch;
+  size_t found = 0, sink = 0;
+
+  start = Clock::now();
+  for(int r = 0; r < reps; r++) {
+    for(size_t i = 0; i < words.size(); i++) {
+      sink += p.isInLexicon(words[i]);
+    }
+  }
+  single = secondsSince(start);
+
+  start = Clock::now();
+  for(int r = 0; r < reps; r++) {
+    p.isInLexicon(words.data(), words.size(), &hits);
+  }
+  batch = secondsSince(start);
+
+  for(size_t i = 0; i < words.size(); i++) {
+    if(hits[i] != p.isInLexicon(words[i])) found = 1;
+  }
+  if(found != 0) std::cerr << "Batched and single lookups disagree." << std::endl;
+
+  double n = (double)words.size() * reps;
+  std::cout << name << ": " << words.size() << " words (" << sink / reps
+            << " found), single "
+            << single / n * 1e9 << " ns/word, batched "
+            << batch / n * 1e9 << " ns/word ("
+            << single / batch << "x)" << std::endl;
+}
+
+static int benchLookup(int argc, char* argv[]) {
+  BogglePlayer p;
+  vector<string> words, shuffled, prefixed;
+  std::mt19937 rng(1);
+
+  if(argc > 3 && !strcmp(argv[3], "-dawg")) p.setLexiconType(DAWG_LEXICON);
+  if(!readWords(argv[2], words) || !p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  // every word, plus a miss differing from it in one letter
+  for(size_t i = 0; i < words.size(); i++) {
+    string miss = words[i];
+    miss[rng() % miss.size()] = 'a' + rng() % 26;
+    shuffled.push_back(words[i]);
+    shuffled.push_back(miss);
+  }
+  std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+  // long words in sorted order: long dependent chains, and
+  // neighbours share most of them
+  for(size_t i = 0; i < words.size(); i++) {
+    if(words[i].size() >= 10) prefixed.push_back(words[i]);
+  }
+  std::sort(prefixed.begin(), prefixed.end());
+
+  timeLookups(p, "random", shuffled, 5);
+  timeLookups(p, "shared prefix", prefixed, 20);
+  return 0;
+}
+
+// the dice of BoggleBoard::initDiceBag()
+static const char* DICE[16][6] = {
+  {"A", "O", "B", "B", "O", "J"}, {"W", "H", "G", "E", "E", "N"},
+  {"N", "R", "N", "Z", "H", "L"}, {"N", "A", "E", "A", "G", "E"},
+  {"D", "I", "Y", "S", "T", "T"}, {"I", "E", "S", "T", "S", "O"},
+  {"A", "O", "T", "T", "W", "O"}, {"H", "Qu", "U", "M", "N", "I"},
+  {"R", "Y", "T", "L", "T", "E"}, {"P", "O", "H", "C", "S", "A"},
+  {"L", "R", "E", "V", "Y", "D"}, {"E", "X", "L", "D", "I", "R"},
+  {"I", "E", "N", "S", "U", "E"}, {"S", "F", "F", "K", "A", "P"},
+  {"I", "O", "T", "M", "U", "C"}, {"E", "H", "W", "V", "T", "R"}
+};
+
+static string** rollBoard(unsigned int rows, unsigned int cols,
+                          std::mt19937& rng) {
+  string** board = new string*[rows];
+  for(unsigned int r = 0; r < rows; r++) {
+    board[r] = new string[cols];
+    for(unsigned int c = 0; c < cols; c++) {
+      board[r][c] = DICE[(r * cols + c) % 16][rng() % 6];
+    }
+  }
+  return board;
+}
+
+static void freeBoard(string** board, unsigned int rows) {
+  for(unsigned int r = 0; r < rows; r++) delete[] board[r];
+  delete[] board;
+}
+
+static int benchSolve(int argc, char* argv[]) {
+  BogglePlayer p;
+  unsigned int rows = atoi(argv[3]), cols = atoi(argv[4]);
+  int n = 1000;
+  bool stream = false, paths = false, search = false;
+  WordPaths recorded;
+  size_t cells = 0;
+  double firstWord = 0;
+  std::mt19937 rng(1);
+  vector<string**> boards;
+  Clock::time_point start;
+  double seconds;
+  size_t found = 0;
+
+  for(int i = 5; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) p.setLexiconType(DAWG_LEXICON);
+    else if(!strcmp(argv[i], "-filter")) p.setBoardFilter(true);
+    else if(!strcmp(argv[i], "-stream")) stream = true;
+    else if(!strcmp(argv[i], "-paths")) paths = true;
+    else if(!strcmp(argv[i], "-isonboard")) search = true;
+    else if(!strcmp(argv[i], "-j") && i + 1 < argc) p.setSolveThreads(atoi(argv[++i]));
+    else n = atoi(argv[i]);
+  }
+  if(rows == 0 || cols == 0 || n <= 0) {
+    std::cerr << "Bad board size or count." << std::endl;
+    return -1;
+  }
+  if(!p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  for(int b = 0; b < n; b++) boards.push_back(rollBoard(rows, cols, rng));
+
+  start = Clock::now();
+  for(int b = 0; b < n; b++) {
+    p.setBoard(rows, cols, boards[b]);
+    if(stream) {
+      CountSink words;
+      Clock::time_point begin = Clock::now();
+      p.getAllValidWords(3, &words);
+      if(words.count > 0) {
+        firstWord += std::chrono::duration<double>(words.first - begin).count();
+      }
+      found += words.count;
+    }
+    else if(paths) {
+      recorded.clear();
+      p.getAllValidWords(3, &recorded);
+      for(unsigned int w = 0; w < recorded.size(); w++) {
+        cells += recorded.pathLength(w);
+      }
+      found += recorded.size();
+    }
+    else {
+      set<string> words;
+      p.getAllValidWords(3, &words);
+      found += words.size();
+      if(search) {
+        for(set<string>::iterator it = words.begin(); it != words.end(); ++it) {
+          cells += p.isOnBoard(*it).size();
+        }
+      }
+    }
+  }
+  seconds = secondsSince(start);
+
+  std::cout << rows << "x" << cols << ": " << n << " boards, "
+            << (double)found / n << " words/board, "
+            << n / seconds << " solves/s ("
+            << seconds / n * 1e6 << " us/solve)" << std::endl;
+  if(paths || search) {
+    std::cout << (double)cells / found << " cells/path" << std::endl;
+  }
+  if(stream) {
+    std::cout << "first word after " << firstWord / n * 1e6 << " us" << std::endl;
+  }
+
+  for(int b = 0; b < n; b++) freeBoard(boards[b], rows);
+  return 0;
+}
+
+static bool readBoard(const char* spec, unsigned int& rows,
+                      unsigned int& cols, vector<string>& faces) {
+  if(!strncmp(spec, "same:", 5)) {
+    const char* size = strrchr(spec, ':');
+    string face(spec + 5, size);
+    if(sscanf(size + 1, "%ux%u", &rows, &cols) != 2) return false;
+    faces.assign(rows * cols, face);
+    return true;
+  }
+  std::ifstream infile(spec);
+  string face;
+  if(!(infile >> rows >> cols)) return false;
+  while(infile >> face) faces.push_back(face);
+  return faces.size() == rows * cols;
+}
+
+static void reportSteal(const char* name, const SearchStats& s,
+                        size_t words) {
+  double busy = 0, first = s.seconds, last = 0;
+  for(size_t t = 0; t < s.busy.size(); t++) {
+    busy += s.busy[t];
+    first = std::min(first, s.finished[t]);
+    last = std::max(last, s.finished[t]);
+  }
+  std::cout << name << ": " << words << " words, " << s.seconds * 1e3
+            << " ms, utilization " << busy / (s.seconds * s.busy.size()) * 100
+            << "%, tail " << (last - first) * 1e3 << " ms, "
+            << s.tasks << " tasks, " << s.steals << " steals" << std::endl;
+  for(size_t t = 0; t < s.busy.size(); t++) {
+    std::cout << "  thread " << t << ": busy " << s.busy[t] * 1e3
+              << " ms, done at " << s.finished[t] * 1e3 << " ms" << std::endl;
+  }
+}
+
+static int benchSteal(int argc, char* argv[]) {
+  WordList list;
+  TST lex;
+  BoardGrid grid;
+  unsigned int rows, cols, threads = std::thread::hardware_concurrency();
+  vector<string> faces;
+  vector<string*> board;
+  SearchStats stats;
+
+  for(int i = 4; i < argc; i++) {
+    if(!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+  }
+  if(threads == 0) threads = 1;
+  if(!list.read(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+  if(!readBoard(argv[3], rows, cols, faces)) {
+    std::cerr << "Could not read board " << argv[3] << "." << std::endl;
+    return -1;
+  }
+
+  lex.build(list.refs.data(), list.refs.size());
+  lex.compact();
+  for(unsigned int r = 0; r < rows; r++) board.push_back(&faces[r * cols]);
+  grid.assign(rows, cols, board.data());
+
+  std::cout << rows << "x" << cols << ", " << threads << " threads" << std::endl;
+  {
+    CountSink words;
+    searchGrid(grid, lex, 0, &words, threads, 0, &stats);
+    reportSteal("start cells only", stats, words.count);
+  }
+  {
+    CountSink words;
+    searchGrid(grid, lex, 0, &words, threads, TaskPool::SPLIT_DEPTH, &stats);
+    reportSteal("split subtrees", stats, words.count);
+  }
+  return 0;
+}
+
+static double percentile(vector<double>& v, double p) {
+  size_t k = (size_t)(p * (v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+static void reportLatency(const char* name, vector<double>& ns) {
+  std::cout << name << ": p50 " << percentile(ns, 0.5) << " ns, p99 "
+            << percentile(ns, 0.99) << " ns" << std::endl;
+}
+
+static int benchOnBoard(int argc, char* argv[]) {
+  BogglePlayer p;
+  vector<string> lexicon, queries;
+  unsigned int rows = atoi(argv[3]), cols = atoi(argv[4]);
+  int n = 200;
+  std::mt19937 rng(1);
+  vector<double> buffered, copied;
+  vector<unsigned int> path;
+  vector< vector<int> > paths;
+  size_t hits = 0, batchHits = 0;
+  double single = 0, batch = 0;
+
+  if(argc > 5) n = atoi(argv[5]);
+  if(rows == 0 || cols == 0 || n <= 0) {
+    std::cerr << "Bad board size or count." << std::endl;
+    return -1;
+  }
+  if(!readWords(argv[2], lexicon) || !p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  path.resize(rows * cols);
+  for(int b = 0; b < n; b++) {
+    string** board = rollBoard(rows, cols, rng);
+    set<string> words;
+    p.setBoard(rows, cols, board);
+    p.getAllValidWords(3, &words);
+
+    // the words on the board, and as many from the lexicon
+    queries.assign(words.begin(), words.end());
+    for(size_t w = 0, m = words.size(); w < m; w++) {
+      queries.push_back(lexicon[rng() % lexicon.size()]);
+    }
+    std::shuffle(queries.begin(), queries.end(), rng);
+
+    // alternately first, so neither call always finds warm caches
+    for(size_t q = 0; q < queries.size(); q++) {
+      for(int k = 0; k < 2; k++) {
+        Clock::time_point start = Clock::now();
+        if((q + k) % 2 == 0) {
+          unsigned int cells = p.isOnBoard(queries[q], path.data());
+          buffered.push_back(secondsSince(start) * 1e9);
+          if(cells > 0) hits++;
+        }
+        else {
+          vector<int> v = p.isOnBoard(queries[q]);
+          copied.push_back(secondsSince(start) * 1e9);
+        }
+      }
+    }
+
+    // a whole round's list, one word at a time and in one batch
+    Clock::time_point start = Clock::now();
+    for(size_t q = 0; q < queries.size(); q++) {
+      p.isOnBoard(queries[q], path.data());
+    }
+    single += secondsSince(start);
+    start = Clock::now();
+    p.isOnBoard(queries.data(), queries.size(), &paths);
+    batch += secondsSince(start);
+    for(size_t q = 0; q < paths.size(); q++) {
+      if(!paths[q].empty()) batchHits++;
+    }
+    freeBoard(board, rows);
+  }
+
+  std::cout << rows << "x" << cols << ": " << n << " boards, "
+            << buffered.size() << " queries, " << hits << " on the board"
+            << std::endl;
+  reportLatency("buffer", buffered);
+  reportLatency("vector", copied);
+  std::cout << "whole list: " << single / n * 1e6 << " us one by one, "
+            << batch / n * 1e6 << " us batched (" << batchHits
+            << " on the board)" << std::endl;
+  return 0;
+}
+
+static int benchStrategy(int argc, char* argv[]) {
+  static const unsigned int SIZES[][2] = {
+    {4, 4}, {5, 5}, {8, 8}, {12, 12}, {20, 23}, {40, 40}
+  };
+  static const unsigned int STRIDES[] = {1, 4, 16, 64, 256, 1024};
+  WordList list;
+  int n = argc > 3 ? atoi(argv[3]) : 20;
+
+  if(n <= 0 || !list.read(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  std::cout << "words  board  walk us  scan us  faster  model" << std::endl;
+  for(unsigned int s = 0; s < sizeof(STRIDES) / sizeof(STRIDES[0]); s++) {
+    vector<WordRef> subset;
+    BogglePlayer p;
+    std::mt19937 rng(1);
+    for(size_t i = 0; i < list.refs.size(); i += STRIDES[s]) {
+      subset.push_back(list.refs[i]);
+    }
+    p.buildLexicon(subset.data(), subset.size());
+    {
+      // the first scan lists the lexicon's words, once per lexicon
+      string face = "a", *row = &face;
+      CountSink words;
+      p.setBoard(1, 1, &row);
+      p.setSolveStrategy(LEXICON_STRATEGY);
+      p.getAllValidWords(3, &words);
+    }
+
+    for(unsigned int b = 0; b < sizeof(SIZES) / sizeof(SIZES[0]); b++) {
+      unsigned int rows = SIZES[b][0], cols = SIZES[b][1];
+      double walk = 0, scan = 0;
+      size_t walked = 0, scanned = 0;
+      for(int k = 0; k < n; k++) {
+        string** board = rollBoard(rows, cols, rng);
+        p.setBoard(rows, cols, board);
+        {
+          CountSink words;
+          p.setSolveStrategy(BOARD_STRATEGY);
+          Clock::time_point start = Clock::now();
+          p.getAllValidWords(3, &words);
+          walk += secondsSince(start);
+          walked += words.count;
+        }
+        {
+          CountSink words;
+          p.setSolveStrategy(LEXICON_STRATEGY);
+          Clock::time_point start = Clock::now();
+          p.getAllValidWords(3, &words);
+          scan += secondsSince(start);
+          scanned += words.count;
+        }
+        freeBoard(board, rows);
+      }
+      if(walked != scanned) {
+        std::cerr << "Strategies disagree." << std::endl;
+        return -1;
+      }
+      std::cout << subset.size() << "  " << rows << "x" << cols << "  "
+                << walk / n * 1e6 << "  " << scan / n * 1e6 << "  "
+                << (walk < scan ? "walk" : "scan") << "  "
+                << (preferScan(rows * cols, subset.size()) ? "scan" : "walk")
+                << std::endl;
+    }
+  }
+  return 0;
+}
+
+static int benchBatch(int argc, char* argv[]) {
+  BogglePlayer p;
+  unsigned int rows = atoi(argv[3]), cols = atoi(argv[4]);
+  unsigned int threads = std::thread::hardware_concurrency();
+  int n = 10000;
+  bool words = false;
+  std::mt19937 rng(1);
+  BoardBatch batch, loaded;
+  BatchResults results;
+  string text;
+  Clock::time_point start;
+  double serial, batched, parse, read;
+  size_t found = 0, solved = 0, score = 0;
+
+  for(int i = 5; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) p.setLexiconType(DAWG_LEXICON);
+    else if(!strcmp(argv[i], "-words")) words = true;
+    else if(!strcmp(argv[i], "-j") && i + 1 < argc) threads = atoi(argv[++i]);
+    else n = atoi(argv[i]);
+  }
+  if(rows == 0 || cols == 0 || n <= 0 || threads == 0) {
+    std::cerr << "Bad board size, count or threads." << std::endl;
+    return -1;
+  }
+  if(!p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  // the same boards, as a batch and as brd.txt-style text
+  for(int b = 0; b < n; b++) {
+    string** board = rollBoard(rows, cols, rng);
+    batch.add(rows, cols, board);
+    text += std::to_string(rows) + "\n" + std::to_string(cols) + "\n";
+    for(unsigned int r = 0; r < rows; r++) {
+      for(unsigned int c = 0; c < cols; c++) text += board[r][c] + "\n";
+    }
+    freeBoard(board, rows);
+  }
+
+  start = Clock::now();
+  loaded.parse(text.data(), text.size());
+  parse = secondsSince(start);
+  if(!batch.write("bogbench.batch")) {
+    std::cerr << "Could not write bogbench.batch." << std::endl;
+    return -1;
+  }
+  start = Clock::now();
+  loaded.read("bogbench.batch");
+  read = secondsSince(start);
+  std::remove("bogbench.batch");
+  if(loaded.size() != batch.size()) std::cerr << "Batch file lost boards." << std::endl;
+
+  // one board at a time, as a caller of setBoard() would
+  start = Clock::now();
+  for(unsigned int b = 0; b < batch.size(); b++) {
+    string** board = new string*[rows];
+    CountSink sink;
+    for(unsigned int r = 0; r < rows; r++) {
+      board[r] = new string[cols];
+      for(unsigned int c = 0; c < cols; c++) {
+        const unsigned char* f = batch.faces(b);
+        for(unsigned int k = 0; k < r * cols + c; k++) f += *f + 1;
+        board[r][c].assign((const char*)f + 1, *f);
+      }
+    }
+    p.setBoard(rows, cols, board);
+    p.getAllValidWords(3, &sink);
+    found += sink.count;
+    freeBoard(board, rows);
+  }
+  serial = secondsSince(start);
+
+  start = Clock::now();
+  p.solveBatch(loaded, 3, &results, words, threads);
+  batched = secondsSince(start);
+  for(unsigned int b = 0; b < results.counts.size(); b++) {
+    solved += results.counts[b];
+    score += results.scores[b];
+  }
+  if(solved != found) std::cerr << "Batch and single solves disagree." << std::endl;
+
+  std::cout << rows << "x" << cols << ": " << n << " boards, "
+            << (double)solved / n << " words/board, "
+            << (double)score / n << " points/board" << std::endl;
+  std::cout << "load: text " << n / parse << " boards/s, batch file "
+            << n / read << " boards/s" << std::endl;
+  std::cout << "one at a time: " << n / serial << " boards/s" << std::endl;
+  std::cout << "batch, " << threads << " threads" << (words ? ", words" : "")
+            << ": " << n / batched << " boards/s, "
+            << n / batched / threads << " boards/s/thread" << std::endl;
+  return 0;
+}
+
+static int benchUpdate(int argc, char* argv[]) {
+  BogglePlayer p, q;
+  unsigned int rows = atoi(argv[3]), cols = atoi(argv[4]);
+  int n = 200, m = 50;
+  std::mt19937 rng(1);
+  Clock::time_point start;
+  double build = 0, update = 0, full = 0;
+  size_t found = 0, expected = 0;
+
+  for(int i = 5, k = 0; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) {
+      p.setLexiconType(DAWG_LEXICON);
+      q.setLexiconType(DAWG_LEXICON);
+    }
+    else if(k++ == 0) n = atoi(argv[i]);
+    else m = atoi(argv[i]);
+  }
+  if(rows == 0 || cols == 0 || n <= 0 || m <= 0) {
+    std::cerr << "Bad board size or count." << std::endl;
+    return -1;
+  }
+  if(!p.loadLexicon(argv[2]) || !q.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  for(int b = 0; b < n; b++) {
+    string** board = rollBoard(rows, cols, rng);
+    p.setBoard(rows, cols, board);
+
+    // the first change builds the tree
+    start = Clock::now();
+    p.updateCell(0, 0, board[0][0]);
+    build += secondsSince(start);
+
+    for(int k = 0; k < m; k++) {
+      unsigned int r = rng() % rows, c = rng() % cols;
+      CountSink mine, theirs;
+      board[r][c] = DICE[(r * cols + c) % 16][rng() % 6];
+
+      start = Clock::now();
+      p.updateCell(r, c, board[r][c]);
+      p.getAllValidWords(3, &mine);
+      update += secondsSince(start);
+
+      start = Clock::now();
+      q.setBoard(rows, cols, board);
+      q.getAllValidWords(3, &theirs);
+      full += secondsSince(start);
+
+      found += mine.count;
+      expected += theirs.count;
+    }
+    freeBoard(board, rows);
+  }
+  if(found != expected) std::cerr << "Incremental and full solves disagree." << std::endl;
+
+  std::cout << rows << "x" << cols << ": " << n << " boards, " << m
+            << " changes each, " << (double)found / n / m << " words/board" << std::endl;
+  std::cout << "first change " << build / n * 1e6 << " us, then "
+            << update / n / m * 1e6 << " us/change; full solve "
+            << full / n / m * 1e6 << " us (" << full / update << "x)" << std::endl;
+  return 0;
+}
+
+// the board turned and mirrored by symmetry s, as ResultCache
+// numbers them
+static string** turnBoard(string** board, unsigned int rows,
+                          unsigned int cols, unsigned int s) {
+  unsigned int rows2 = (s & 4) ? cols : rows, cols2 = (s & 4) ? rows : cols;
+  string** turned = new string*[rows2];
+  for(unsigned int i = 0; i < rows2; i++) {
+    turned[i] = new string[cols2];
+    for(unsigned int j = 0; j < cols2; j++) {
+      unsigned int r = (s & 4) ? j : i, c = (s & 4) ? i : j;
+      if(s & 1) r = rows - 1 - r;
+      if(s & 2) c = cols - 1 - c;
+      turned[i][j] = board[r][c];
+    }
+  }
+  return turned;
+}
+
+static int benchCache(int argc, char* argv[]) {
+  BogglePlayer p, q;
+  unsigned int rows = atoi(argv[3]), cols = atoi(argv[4]);
+  int n = 1000, m = 10000, size = -1;
+  std::mt19937 rng(1);
+  vector<string**> turned;
+  vector<unsigned int> picks;
+  Clock::time_point start;
+  double cached, plain, hit;
+  size_t found = 0, expected = 0;
+
+  for(int i = 5, k = 0; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) {
+      p.setLexiconType(DAWG_LEXICON);
+      q.setLexiconType(DAWG_LEXICON);
+    }
+    else if(!strcmp(argv[i], "-size") && i + 1 < argc) size = atoi(argv[++i]);
+    else if(k++ == 0) n = atoi(argv[i]);
+    else m = atoi(argv[i]);
+  }
+  if(rows == 0 || cols == 0 || n <= 0 || m <= 0) {
+    std::cerr << "Bad board size or count." << std::endl;
+    return -1;
+  }
+  if(!p.loadLexicon(argv[2]) || !q.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+  p.setResultCache(size < 0 ? n : size);
+
+  // every turn of every board, made up front
+  for(int b = 0; b < n; b++) {
+    string** board = rollBoard(rows, cols, rng);
+    for(unsigned int s = 0; s < 8; s++) turned.push_back(turnBoard(board, rows, cols, s));
+    freeBoard(board, rows);
+  }
+  for(int k = 0; k < m; k++) picks.push_back(rng() % turned.size());
+
+  start = Clock::now();
+  for(int k = 0; k < m; k++) {
+    unsigned int s = picks[k] % 8;
+    CountSink words;
+    q.setBoard((s & 4) ? cols : rows, (s & 4) ? rows : cols, turned[picks[k]]);
+    q.getAllValidWords(3, &words);
+    expected += words.count;
+  }
+  plain = secondsSince(start);
+
+  start = Clock::now();
+  for(int k = 0; k < m; k++) {
+    unsigned int s = picks[k] % 8;
+    CountSink words;
+    p.setBoard((s & 4) ? cols : rows, (s & 4) ? rows : cols, turned[picks[k]]);
+    p.getAllValidWords(3, &words);
+    found += words.count;
+  }
+  cached = secondsSince(start);
+  if(found != expected) std::cerr << "Cached and plain solves disagree." << std::endl;
+  std::cout << rows << "x" << cols << ": " << m << " solves of " << n << " boards, "
+            << p.cacheHits() << " hits, " << p.cacheMisses() << " misses" << std::endl;
+  std::cout << "no cache " << plain / m * 1e6 << " us/solve, cached "
+            << cached / m * 1e6 << " us/solve (" << plain / cached << "x)" << std::endl;
+
+  // once every board is held, each solve is a hit
+  if(size < 0) {
+    unsigned long long hits = p.cacheHits();
+    start = Clock::now();
+    for(int k = 0; k < m; k++) {
+      unsigned int s = picks[k] % 8;
+      CountSink words;
+      p.setBoard((s & 4) ? cols : rows, (s & 4) ? rows : cols, turned[picks[k]]);
+      p.getAllValidWords(3, &words);
+    }
+    hit = secondsSince(start);
+    if(p.cacheHits() - hits == (unsigned long long)m) {
+      std::cout << "hit " << hit / m * 1e6 << " us/solve" << std::endl;
+    }
+  }
+
+  for(size_t b = 0; b < turned.size(); b++) {
+    freeBoard(turned[b], (b % 8 & 4) ? cols : rows);
+  }
+  return 0;
+}
+
+// scores the words it is given under the standard rules
+class ScoreSink : public WordSink {
+public:
+  unsigned int score;
+  ScoreSink() : score(0) {}
+  void word(const char* data, unsigned int length,
+            const unsigned int* path, unsigned int cells) {
+    score += scoreWord(length);
+  }
+};
+
+static int benchAnneal(int argc, char* argv[]) {
+  BogglePlayer p;
+  AnnealSettings settings;
+  AnnealReport report;
+  std::mt19937 rng(1);
+  Clock::time_point start;
+  unsigned int sampled = 0, best = 0;
+
+  settings.seconds = 10;
+  for(int i = 3; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) p.setLexiconType(DAWG_LEXICON);
+    else if(!strcmp(argv[i], "-j") && i + 1 < argc) settings.threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-chains") && i + 1 < argc) settings.chains = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-steps") && i + 1 < argc) settings.steps = atoll(argv[++i]);
+    else settings.seconds = atof(argv[i]);
+  }
+  if(!p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  p.annealBoards(settings, &report);
+  std::cout << report.solves << " boards solved in " << report.seconds << " s ("
+            << report.solves / report.seconds << " boards/s), "
+            << report.accepted << " moves kept" << std::endl;
+  for(size_t b = 0; b < report.best.size() && b < 3; b++) {
+    std::cout << "score " << report.best[b].score << ", "
+              << report.best[b].words << " words:";
+    for(size_t k = 0; k < report.best[b].faces.size(); k++) {
+      std::cout << (k % 4 == 0 ? "  " : " ") << report.best[b].faces[k];
+    }
+    std::cout << std::endl;
+  }
+
+  // the hunt annealing replaces
+  start = Clock::now();
+  while(secondsSince(start) < report.seconds) {
+    string** board = rollBoard(4, 4, rng);
+    ScoreSink sink;
+    p.setBoard(4, 4, board);
+    p.getAllValidWords(settings.min, &sink);
+    best = std::max(best, sink.score);
+    sampled++;
+    freeBoard(board, 4);
+  }
+  std::cout << "random boards: best score " << best << " of " << sampled << std::endl;
+  return 0;
+}
+
+static int benchStats(int argc, char* argv[]) {
+  BogglePlayer p;
+  SampleSettings settings;
+  SampleReport report;
+  std::mt19937 rng(1);
+  Clock::time_point start;
+  unsigned long long rolled = 0;
+
+  for(int i = 3; i < argc; i++) {
+    if(!strcmp(argv[i], "-dawg")) p.setLexiconType(DAWG_LEXICON);
+    else if(!strcmp(argv[i], "-j") && i + 1 < argc) settings.threads = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "-shuffle")) settings.shuffle = 1;
+    else if(!strcmp(argv[i], "-seed") && i + 1 < argc) settings.seed = atoll(argv[++i]);
+    else settings.samples = atoll(argv[i]);
+  }
+  if(!p.loadLexicon(argv[2])) {
+    std::cerr << "Could not read " << argv[2] << "." << std::endl;
+    return -1;
+  }
+
+  p.sampleBoards(settings, &report);
+  writeSampleReport(std::cout, report);
+
+  // the loop sampleBoards() replaces, for a tenth of the time
+  start = Clock::now();
+  while(rolled < settings.samples && secondsSince(start) < report.seconds / 10) {
+    string** board = rollBoard(4, 4, rng);
+    CountSink words;
+    p.setBoard(4, 4, board);
+    p.getAllValidWords(settings.min, &words);
+    rolled++;
+    freeBoard(board, 4);
+  }
+  std::cout << "setBoard() and getAllValidWords(): "
+            << rolled / secondsSince(start) << " boards/s" << std::endl;
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+
+  if(argc > 2 && !strcmp(argv[1], "lookup")) return benchLookup(argc, argv);
+  if(argc > 4 && !strcmp(argv[1], "solve")) return benchSolve(argc, argv);
+  if(argc > 3 && !strcmp(argv[1], "steal")) return benchSteal(argc, argv);
+  if(argc > 4 && !strcmp(argv[1], "onboard")) return benchOnBoard(argc, argv);
+  if(argc > 2 && !strcmp(argv[1], "strategy")) return benchStrategy(argc, argv);
+  if(argc > 4 && !strcmp(argv[1], "batch")) return benchBatch(argc, argv);
+  if(argc > 4 && !strcmp(argv[1], "update")) return benchUpdate(argc, argv);
+  if(argc > 4 && !strcmp(argv[1], "cache")) return benchCache(argc, argv);
+  if(argc > 2 && !strcmp(argv[1], "anneal")) return benchAnneal(argc, argv);
+  if(argc > 2 && !strcmp(argv[1], "stats")) return benchStats(argc, argv);
+
+  std::cerr << "Usage: " << argv[0] << " lookup wordlist [-dawg]" << std::endl;
+  std::cerr << "       " << argv[0] << " solve wordlist rows cols [boards] [-dawg] [-filter] [-j threads] [-stream | -paths | -isonboard]" << std::endl;
+  std::cerr << "       " << argv[0] << " steal wordlist board [-j threads]" << std::endl;
+  std::cerr << "       " << argv[0] << " onboard wordlist rows cols [boards]" << std::endl;
+  std::cerr << "       " << argv[0] << " strategy wordlist [boards]" << std::endl;
+  std::cerr << "       " << argv[0] << " batch wordlist rows cols [boards] [-dawg] [-j threads] [-words]" << std::endl;
+  std::cerr << "       " << argv[0] << " update wordlist rows cols [boards [changes]] [-dawg]" << std::endl;
+  std::cerr << "       " << argv[0] << " cache wordlist rows cols [boards [solves]] [-dawg] [-size entries]" << std::endl;
+  std::cerr << "       " << argv[0] << " anneal wordlist [seconds] [-dawg] [-j threads] [-chains chains] [-steps steps]" << std::endl;
+  std::cerr << "       " << argv[0] << " stats wordlist [samples] [-dawg] [-j threads] [-shuffle] [-seed seed]" << std::endl;
+  return -1;
+
+}
@@ -0,0 +1,332 @@
+#include "boggleanneal.h"
+#include "bogglebatch.h"
+#include "boggledawg.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// the dice of BoggleBoard::initDiceBag()
+static const char* const STANDARD_DICE[16][6] = {
+    { "A", "O", "B", "B", "O", "J" }, { "W", "H", "G", "E", "E", "N" },
+    { "N", "R", "N", "Z", "H", "L" }, { "N", "A", "E", "A", "G", "E" },
+    { "D", "I", "Y", "S", "T", "T" }, { "I", "E", "S", "T", "S", "O" },
+    { "A", "O", "T", "T", "W", "O" }, { "H", "Qu", "U", "M", "N", "I" },
+    { "R", "Y", "T", "L", "T", "E" }, { "P", "O", "H", "C", "S", "A" },
+    { "L", "R", "E", "V", "Y", "D" }, { "E", "X", "L", "D", "I", "R" },
+    { "I", "E", "N", "S", "U", "E" }, { "S", "F", "F", "K", "A", "P" },
+    { "I", "O", "T", "M", "U", "C" }, { "E", "H", "W", "V", "T", "R" }
+};
+
+/**
+ * Returns the dice of BoggleBoard::initDiceBag(), the standard 16
+ * dice of a 4x4 board.
+ */
+DiceFaces standardDice() {
+    DiceFaces dice( 16 );
+
+    for ( unsigned int d = 0; d < 16; d++ ) {
+        dice[d].assign( STANDARD_DICE[d], STANDARD_DICE[d] + 6 );
+    }
+    return dice;
+}
+
+/**
+ * Judges whether boards can be rolled from a set of dice.
+ */
+bool validDice( const DiceFaces& dice ) {
+    for ( unsigned int d = 0; d < dice.size(); d++ ) {
+        if ( dice[d].empty() ) return 0;
+        for ( unsigned int s = 0; s < dice[d].size(); s++ ) {
+            if ( dice[d][s].length() > BoardBatch::MAX_FACE ) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Counts and scores the words of a board.
+ */
+class AnnealSink : public WordSink {
+
+public:
+    unsigned int count;
+    unsigned int score;
+
+    AnnealSink() : count(0), score(0) {}
+
+    void word( const char* data, unsigned int length,
+               const unsigned int* path, unsigned int cells ) {
+        count++;
+        score += scoreWord( length );
+    }
+
+};
+
+/**
+ * One chain of annealBoards(): a board kept to the dice, the
+ * search that scores it, and the generator of its moves.
+ *
+ * die[i] is the die on cell i and side[i] the face of it showing;
+ * a move changes the board through BoardGrid::setFace(), so the
+ * grid keeps its arrays and the search its buffers.
+ */
+template<class L>
+class AnnealChain {
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const DiceFaces& dice;
+    const AnnealSettings& settings;
+    BoardGrid grid;
+    AnnealSink sink;
+    SearchSet<L> searches;
+    std::mt19937_64 rng;
+    vector<unsigned int> die;
+    vector<unsigned int> side;
+    unsigned int words;
+    unsigned int score;
+
+    /**
+     * Solves the board, setting words and score.
+     */
+    void solve() {
+        sink.count = 0;
+        sink.score = 0;
+        searches.search();
+        words = sink.count;
+        score = sink.score;
+        solves++;
+    }
+
+    /**
+     * Shows the face of the die on a cell on the board.
+     */
+    void show( unsigned int cell ) {
+        grid.setFace( cell, dice[ die[cell] ][ side[cell] ] );
+    }
+
+    /**
+     * Makes the board the best of the chain if it scores higher.
+     */
+    void keep() {
+        if ( !best.faces.empty() && score <= best.score ) return;
+        best.faces.resize( grid.size );
+        for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+            best.faces[cell] = dice[ die[cell] ][ side[cell] ];
+        }
+        best.words = words;
+        best.score = score;
+    }
+
+public:
+    AnnealBoard best;
+    unsigned long long solves;
+    unsigned long long accepted;
+
+    /**
+     * Constructs chain number chain, on a board rolled from the
+     * dice at random.
+     */
+    AnnealChain( const L& lex, const DiceFaces& dice,
+                 const AnnealSettings& settings, unsigned int chain )
+        : dice(dice), settings(settings),
+          searches( grid, lex, settings.min, &sink ),
+          words(0), score(0), solves(0), accepted(0) {
+        unsigned int n = settings.rows * settings.cols;
+        std::seed_seq seq = { (unsigned int)settings.seed,
+                              (unsigned int)( settings.seed >> 32 ), chain };
+        vector<unsigned char> packed;
+
+        rng.seed( seq );
+        die.resize( n );
+        side.resize( n );
+        for ( unsigned int cell = 0; cell < n; cell++ ) {
+            die[cell] = cell % dice.size();
+        }
+        std::shuffle( die.begin(), die.end(), rng );
+        for ( unsigned int cell = 0; cell < n; cell++ ) {
+            side[cell] = rng() % dice[ die[cell] ].size();
+            const string& f = dice[ die[cell] ][ side[cell] ];
+            packed.push_back( f.length() );
+            packed.insert( packed.end(), f.begin(), f.end() );
+        }
+        grid.assign( settings.rows, settings.cols, packed.data() );
+    }
+
+    /**
+     * Anneals the board for seconds seconds, or until the chain has
+     * taken settings.steps steps if that is not 0 and comes first.
+     */
+    void run( double seconds ) {
+        Clock::time_point start = Clock::now();
+        unsigned int n = grid.size;
+        double ratio = settings.endTemperature / settings.startTemperature;
+        std::uniform_real_distribution<double> uniform( 0, 1 );
+
+        solve();
+        keep();
+
+        for ( unsigned long long step = 0; ; step++ ) {
+            double elapsed = std::chrono::duration<double>(
+                                 Clock::now() - start ).count();
+            double progress = elapsed / seconds;
+            unsigned int a = rng() % n, b = a, old = side[a];
+            unsigned int before = score, found = words;
+
+            // with a step budget the schedule follows the steps
+            // alone, so the clock can stop a chain but not steer it
+            if ( settings.steps != 0 ) {
+                if ( step >= settings.steps ) break;
+                progress = (double)step / settings.steps;
+            }
+            if ( elapsed >= seconds ) break;
+
+            // turn one die, or swap two; a move that shows the same
+            // letters changes nothing, and costs no solve
+            if ( n < 2 || rng() % 2 == 0 ) {
+                unsigned int faces = dice[ die[a] ].size();
+                if ( faces < 2 ) continue;
+                side[a] = rng() % ( faces - 1 );
+                if ( side[a] >= old ) side[a]++;
+                if ( dice[ die[a] ][ side[a] ] == dice[ die[a] ][old] ) {
+                    continue;
+                }
+                show( a );
+            }
+            else {
+                b = rng() % ( n - 1 );
+                if ( b >= a ) b++;
+                if ( dice[ die[a] ][ side[a] ]
+                       == dice[ die[b] ][ side[b] ] ) {
+                    continue;
+                }
+                std::swap( die[a], die[b] );
+                std::swap( side[a], side[b] );
+                show( a );
+                show( b );
+            }
+
+            solve();
+            if ( score >= before
+                   || uniform( rng ) < std::exp( ( (double)score - before )
+                        / ( settings.startTemperature
+                              * std::pow( ratio, progress ) ) ) ) {
+                accepted++;
+                keep();
+                continue;
+            }
+
+            // undone, without solving again
+            if ( a == b ) {
+                side[a] = old;
+                show( a );
+            }
+            else {
+                std::swap( die[a], die[b] );
+                std::swap( side[a], side[b] );
+                show( a );
+                show( b );
+            }
+            score = before;
+            words = found;
+        }
+    }
+
+};
+
+/**
+ * Searches for the boards of settings.rows rows and settings.cols
+ * columns whose words of at least settings.min letters in a
+ * lexicon score highest under the standard rules, into report.
+ *
+ * Thread t runs chains t, t + threads and so on, one after
+ * another, each until its share of the time is up.
+ */
+template<class L>
+void annealBoards( const L& lex, const AnnealSettings& settings,
+                   AnnealReport* report ) {
+    typedef std::chrono::steady_clock Clock;
+    DiceFaces standard;
+    const DiceFaces* dice = &settings.dice;
+    unsigned int threads = settings.threads, chains = settings.chains;
+    vector<AnnealBoard> best;
+    vector<unsigned long long> solves, accepted;
+    vector<std::thread> pool;
+    Clock::time_point start = Clock::now();
+
+    report->best.clear();
+    report->solves = 0;
+    report->accepted = 0;
+    report->seconds = 0;
+
+    if ( !validDice( *dice ) || settings.rows == 0 || settings.cols == 0 ) {
+        return;
+    }
+    if ( dice->empty() ) {
+        standard = standardDice();
+        dice = &standard;
+    }
+
+    if ( threads == 0 ) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if ( threads == 0 ) {
+        threads = 1;
+    }
+    if ( chains == 0 ) {
+        chains = threads;
+    }
+    if ( threads > chains ) {
+        threads = chains;
+    }
+
+    best.resize( chains );
+    solves.assign( chains, 0 );
+    accepted.assign( chains, 0 );
+    auto work = [&]( unsigned int t ) {
+        unsigned int mine = ( chains - t + threads - 1 ) / threads;
+        for ( unsigned int c = t, k = 1; c < chains; c += threads, k++ ) {
+            AnnealChain<L> chain( lex, *dice, settings, c );
+            double left = settings.seconds * k / mine
+                        - std::chrono::duration<double>(
+                              Clock::now() - start ).count();
+            chain.run( std::max( left, 0.0 ) );
+            best[c] = chain.best;
+            solves[c] = chain.solves;
+            accepted[c] = chain.accepted;
+        }
+    };
+
+    for ( unsigned int t = 1; t < threads; t++ ) {
+        pool.push_back( std::thread( work, t ) );
+    }
+    work( 0 );
+    for ( unsigned int t = 0; t < pool.size(); t++ ) {
+        pool[t].join();
+    }
+
+    // best first; chains that met on a board report it once
+    std::sort( best.begin(), best.end(),
+               []( const AnnealBoard& a, const AnnealBoard& b ) {
+                   return a.score != b.score ? a.score > b.score
+                                             : a.faces < b.faces;
+               } );
+    for ( unsigned int c = 0; c < chains; c++ ) {
+        if ( best[c].faces.empty() ) continue;
+        if ( report->best.empty() || best[c].faces != report->best.back().faces ) {
+            report->best.push_back( best[c] );
+        }
+        report->solves += solves[c];
+        report->accepted += accepted[c];
+    }
+    report->seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+template void annealBoards<TST>( const TST&, const AnnealSettings&,
+                                 AnnealReport* );
+template void annealBoards<DAWG>( const DAWG&, const AnnealSettings&,
+                                  AnnealReport* );
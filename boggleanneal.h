@@ -0,0 +1,115 @@
+#ifndef BOGGLEANNEAL_H
+#define BOGGLEANNEAL_H
+
+#include <vector>
+#include <string>
+
+#include "boggleutil.h"
+#include "bogglegrid.h"
+
+using std::vector;
+using std::string;
+
+/**
+ * The faces of a set of dice: dice[d] holds the faces of die d.
+ */
+typedef vector< vector<string> > DiceFaces;
+
+/**
+ * Returns the dice of BoggleBoard::initDiceBag(), the standard 16
+ * dice of a 4x4 board.
+ */
+DiceFaces standardDice();
+
+/**
+ * Judges whether boards can be rolled from a set of dice: every die
+ * has a face, and no face is longer than BoardBatch::MAX_FACE
+ * characters, the most a packed board holds. An empty set stands
+ * for standardDice().
+ */
+bool validDice(const DiceFaces& dice);
+
+/**
+ * Settings of annealBoards().
+ *
+ * The boards are rolled from dice, or from standardDice() if it
+ * is empty. chains independent chains, or one per thread if 0, run
+ * on threads threads, or one per hardware thread if 0, until
+ * seconds have passed, each chain getting an equal share of its
+ * thread's time, or until every chain has taken steps steps, if
+ * steps is not 0. A chain's temperature, in points, falls
+ * geometrically from startTemperature to endTemperature over its
+ * share of the time, or over its steps if steps is not 0, when
+ * the clock only stops a chain that runs out of time; a move
+ * losing d points is kept with probability exp(-d / temperature).
+ * The defaults suit a full English word list, whose best 4x4
+ * boards score in the thousands. Chain c draws its moves from a
+ * generator seeded with seed and c, so with a step budget that
+ * time does not cut short, the boards found do not depend on the
+ * number of threads.
+ */
+struct AnnealSettings {
+    DiceFaces dice;
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int min;
+    unsigned int chains;
+    unsigned int threads;
+    double seconds;
+    unsigned long long steps;
+    double startTemperature;
+    double endTemperature;
+    unsigned long long seed;
+
+    /**
+     * Constructs the settings of a 10 second search for 4x4 boards
+     * of words of at least 3 letters, with one chain per hardware
+     * thread.
+     */
+    AnnealSettings()
+        : rows(4), cols(4), min(3), chains(0), threads(0), seconds(10),
+          steps(0), startTemperature(100), endTemperature(2), seed(1) {}
+};
+
+/**
+ * A board annealBoards() found: its faces, row by row, as the dice
+ * show them, and the number and score of its words.
+ */
+struct AnnealBoard {
+    vector<string> faces;
+    unsigned int words;
+    unsigned int score;
+};
+
+/**
+ * What annealBoards() found: the best board of every chain, best
+ * first, each board once, and how many boards were solved and how
+ * many moves kept, over how many seconds.
+ */
+struct AnnealReport {
+    vector<AnnealBoard> best;
+    unsigned long long solves;
+    unsigned long long accepted;
+    double seconds;
+};
+
+/**
+ * Searches for the boards of settings.rows rows and settings.cols
+ * columns whose words of at least settings.min letters in a
+ * lexicon score highest under the standard rules, into report.
+ *
+ * L is TST or DAWG. Cell i of a board starts with die i modulo the
+ * number of dice, as BoggleBoard::initRandomBoard() rolls them,
+ * and the dice are shuffled; a move either turns one die to
+ * another of its faces or swaps two dice, so every board keeps to
+ * the dice. Each chain solves its boards on one BoardGrid through
+ * one SearchSet, scoring the words as the search finds them, and
+ * keeps a move that scores higher, or lower with the probability
+ * the temperature gives, undoing it otherwise. The report is left
+ * empty if the dice fail validDice() or the board has no cells.
+ */
+template<class L>
+void annealBoards(const L& lex, const AnnealSettings& settings,
+                  AnnealReport* report);
+
+#endif // BOGGLEANNEAL_H
@@ -0,0 +1,404 @@
+#include "bogglebatch.h"
+#include "boggledawg.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+const unsigned int BoardBatch::MAX_SIDE;
+const unsigned int BoardBatch::MAX_FACE;
+
+static const char MAGIC[8] = { 'B', 'O', 'G', 'B', 'A', 'T', 'C', 'H' };
+static const unsigned int VERSION = 1;
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+// boards a thread of solveBatch() takes at a time
+static const unsigned int CHUNK_BOARDS = 64;
+
+/**
+ * Removes every board, keeping the capacity.
+ */
+void BoardBatch::clear() {
+    data.clear();
+    starts.clear();
+}
+
+/**
+ * Adds a board, given as setBoard() takes it.
+ *
+ * Returns false, adding nothing, if a side or a face is too long
+ * for a record.
+ */
+bool BoardBatch::add( unsigned int rows, unsigned int cols,
+                      string** dice ) {
+    unsigned short side[2] = { (unsigned short)rows, (unsigned short)cols };
+    unsigned char bytes[4];
+
+    if ( rows > MAX_SIDE || cols > MAX_SIDE ) return 0;
+    for ( unsigned int i = 0; i < rows; i++ ) {
+        for ( unsigned int j = 0; j < cols; j++ ) {
+            if ( dice[i][j].length() > MAX_FACE ) return 0;
+        }
+    }
+
+    starts.push_back( data.size() );
+    memcpy( bytes, side, sizeof( bytes ) );
+    data.insert( data.end(), bytes, bytes + sizeof( bytes ) );
+    for ( unsigned int i = 0; i < rows; i++ ) {
+        for ( unsigned int j = 0; j < cols; j++ ) {
+            data.push_back( dice[i][j].length() );
+            data.insert( data.end(), dice[i][j].begin(), dice[i][j].end() );
+        }
+    }
+    return 1;
+}
+
+/**
+ * Returns the number of rows of a board.
+ */
+unsigned int BoardBatch::rows( unsigned int b ) const {
+    unsigned short side[2];
+    memcpy( side, &data[ starts[b] ], sizeof( side ) );
+    return side[0];
+}
+
+/**
+ * Returns the number of columns of a board.
+ */
+unsigned int BoardBatch::cols( unsigned int b ) const {
+    unsigned short side[2];
+    memcpy( side, &data[ starts[b] ], sizeof( side ) );
+    return side[1];
+}
+
+/**
+ * Indexes the records in data, checking that they fill it.
+ *
+ * Returns false, leaving the batch empty, if they do not.
+ */
+bool BoardBatch::index( unsigned int count ) {
+    size_t pos = 0, end = data.size();
+    unsigned short side[2];
+
+    starts.clear();
+    for ( unsigned int b = 0; b < count; b++ ) {
+        size_t p = pos + sizeof( side );
+        if ( p > end ) break;
+        memcpy( side, &data[pos], sizeof( side ) );
+        for ( unsigned int cell = 0; cell < (unsigned int)side[0] * side[1]
+                                     && p <= end; cell++ ) {
+            p += p < end ? data[p] + 1 : 1;
+        }
+        if ( p > end ) break;
+        starts.push_back( pos );
+        pos = p;
+    }
+
+    if ( starts.size() != count || pos != end ) {
+        clear();
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Reads a batch file written by write(), replacing the boards.
+ *
+ * Returns false, leaving the batch empty, if the file cannot be
+ * read or was written by another version or host.
+ */
+bool BoardBatch::read( const char* path ) {
+    BatchHeader h;
+    FILE *f;
+    long length = 0;
+    bool ok;
+
+    clear();
+    f = fopen( path, "rb" );
+    if ( f == nullptr ) return 0;
+
+    ok = fread( &h, sizeof( h ), 1, f ) == 1
+           && memcmp( h.magic, MAGIC, sizeof( MAGIC ) ) == 0
+           && h.version == VERSION
+           && h.byteOrder == BYTE_ORDER_MARK
+           && fseek( f, 0, SEEK_END ) == 0
+           && ( length = ftell( f ) ) >= (long)sizeof( h )
+           && fseek( f, sizeof( h ), SEEK_SET ) == 0;
+    if ( ok ) {
+        data.resize( length - sizeof( h ) );
+        ok = data.empty()
+               || fread( data.data(), 1, data.size(), f ) == data.size();
+    }
+    fclose( f );
+
+    if ( !ok ) {
+        clear();
+        return 0;
+    }
+    return index( h.count );
+}
+
+/**
+ * Writes the boards to a batch file.
+ *
+ * Returns false if the file cannot be written.
+ */
+bool BoardBatch::write( const char* path ) const {
+    BatchHeader h;
+    FILE *f;
+    bool ok;
+
+    memset( &h, 0, sizeof( h ) );
+    memcpy( h.magic, MAGIC, sizeof( MAGIC ) );
+    h.version = VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.count = starts.size();
+
+    f = fopen( path, "wb" );
+    if ( f == nullptr ) return 0;
+
+    ok = fwrite( &h, sizeof( h ), 1, f ) == 1;
+    if ( ok && !data.empty() ) {
+        ok = fwrite( data.data(), 1, data.size(), f ) == data.size();
+    }
+
+    return fclose( f ) == 0 && ok;
+}
+
+/**
+ * Finds the next run of characters other than white space, from
+ * p on; returns its length, 0 at the end of the text.
+ */
+static size_t nextToken( const char*& p, const char* end,
+                         const char*& token ) {
+    while ( p < end && isspace( (unsigned char)*p ) ) p++;
+    token = p;
+    while ( p < end && !isspace( (unsigned char)*p ) ) p++;
+    return p - token;
+}
+
+/**
+ * Reads a side of a board from a token of digits.
+ *
+ * Returns false if it is not a number a record can hold.
+ */
+static bool parseSide( const char* token, size_t n, unsigned int& side ) {
+    side = 0;
+    if ( n == 0 ) return 0;
+    for ( size_t k = 0; k < n; k++ ) {
+        if ( !isdigit( (unsigned char)token[k] ) ) return 0;
+        side = side * 10 + ( token[k] - '0' );
+        if ( side > BoardBatch::MAX_SIDE ) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Parses boards in the brd.txt format, one after another,
+ * replacing the boards: the rows, the columns and then every face,
+ * row by row, all separated by white space.
+ *
+ * Returns false, leaving the batch empty, if a board is cut short
+ * or a record cannot hold it.
+ */
+bool BoardBatch::parse( const char* text, size_t length ) {
+    const char *p = text, *end = text + length, *token;
+    unsigned int side[2];
+    unsigned short packed[2];
+    unsigned char bytes[4];
+    size_t n;
+
+    clear();
+    while ( ( n = nextToken( p, end, token ) ) > 0 ) {
+        if ( !parseSide( token, n, side[0] )
+               || !parseSide( token, nextToken( p, end, token ), side[1] ) ) {
+            clear();
+            return 0;
+        }
+
+        starts.push_back( data.size() );
+        packed[0] = side[0];
+        packed[1] = side[1];
+        memcpy( bytes, packed, sizeof( bytes ) );
+        data.insert( data.end(), bytes, bytes + sizeof( bytes ) );
+
+        for ( unsigned int cell = 0; cell < side[0] * side[1]; cell++ ) {
+            n = nextToken( p, end, token );
+            if ( n == 0 || n > MAX_FACE ) {
+                clear();
+                return 0;
+            }
+            data.push_back( n );
+            data.insert( data.end(), token, token + n );
+        }
+    }
+    return 1;
+}
+
+/**
+ * Reads a file of boards in the brd.txt format, as parse() does.
+ *
+ * Returns false, leaving the batch empty, if the file cannot be
+ * read or parsed.
+ */
+bool BoardBatch::readText( const char* path ) {
+    vector<char> text;
+    FILE *f;
+    long length = 0;
+    bool ok;
+
+    clear();
+    f = fopen( path, "rb" );
+    if ( f == nullptr ) return 0;
+
+    ok = fseek( f, 0, SEEK_END ) == 0
+           && ( length = ftell( f ) ) >= 0
+           && fseek( f, 0, SEEK_SET ) == 0;
+    if ( ok ) {
+        text.resize( length );
+        ok = text.empty()
+               || fread( text.data(), 1, text.size(), f ) == text.size();
+    }
+    fclose( f );
+
+    return ok && parse( text.data(), text.size() );
+}
+
+/**
+ * Returns the points a word of the specified number of letters
+ * scores under the standard rules.
+ */
+unsigned int scoreWord( unsigned int length ) {
+    static const unsigned int POINTS[9] = { 0, 0, 0, 1, 1, 2, 3, 5, 11 };
+    return POINTS[ length < 8 ? length : 8 ];
+}
+
+/**
+ * Counts and scores the words of a board, and appends them to a
+ * buffer, each followed by a newline, if it has one.
+ */
+class BatchSink : public WordSink {
+
+public:
+    unsigned int count;
+    unsigned int score;
+    vector<char>* text;
+
+    BatchSink() : count(0), score(0), text(nullptr) {}
+
+    void word( const char* data, unsigned int length,
+               const unsigned int* path, unsigned int cells ) {
+        count++;
+        score += scoreWord( length );
+        if ( text != nullptr ) {
+            text->insert( text->end(), data, data + length );
+            text->push_back( '\n' );
+        }
+    }
+
+};
+
+/**
+ * The board, searches and sink one thread of solveBatch() builds
+ * once and reuses for every board it solves.
+ */
+template<class L>
+class BatchWorker {
+
+private:
+    BoardGrid grid;
+    BatchSink sink;
+    SearchSet<L> searches;
+
+public:
+    BatchWorker( const L& lex, unsigned int min )
+        : searches( grid, lex, min, &sink ) {}
+
+    /**
+     * Solves a board of a batch into results, appending its words
+     * to text unless it is null.
+     */
+    void solve( const BoardBatch& boards, unsigned int b,
+                BatchResults* results, vector<char>* text ) {
+        grid.assign( boards.rows( b ), boards.cols( b ), boards.faces( b ) );
+        sink.count = 0;
+        sink.score = 0;
+        sink.text = text;
+
+        searches.search();
+
+        results->counts[b] = sink.count;
+        results->scores[b] = sink.score;
+    }
+
+};
+
+/**
+ * Finds the words of at least min letters which a lexicon holds on
+ * every board of a batch, into results, keeping the words as well
+ * if words is set.
+ *
+ * Chunks of consecutive boards are handed out through one counter;
+ * a chunk's words go to a buffer of its own, so joining them in
+ * chunk order puts every board's words in place.
+ */
+template<class L>
+void solveBatch( const BoardBatch& boards, const L& lex, unsigned int min,
+                 BatchResults* results, bool words, unsigned int threads ) {
+    unsigned int n = boards.size();
+    unsigned int chunks = ( n + CHUNK_BOARDS - 1 ) / CHUNK_BOARDS;
+    vector< vector<char> > chunkText( words ? chunks : 0 );
+    std::atomic<unsigned int> next( 0 );
+    vector<std::thread> pool;
+
+    results->counts.assign( n, 0 );
+    results->scores.assign( n, 0 );
+    results->text.clear();
+    results->textStart.assign( words ? n + 1 : 0, 0 );
+
+    if ( threads > chunks ) {
+        threads = chunks;
+    }
+    if ( threads == 0 ) return;
+
+    auto work = [&]() {
+        BatchWorker<L> worker( lex, min );
+        unsigned int c;
+        while ( ( c = next++ ) < chunks ) {
+            unsigned int last = std::min( n, ( c + 1 ) * CHUNK_BOARDS );
+            vector<char>* text = words ? &chunkText[c] : nullptr;
+            for ( unsigned int b = c * CHUNK_BOARDS; b < last; b++ ) {
+                worker.solve( boards, b, results, text );
+                if ( words ) results->textStart[b+1] = text->size();
+            }
+        }
+    };
+
+    for ( unsigned int t = 1; t < threads; t++ ) {
+        pool.push_back( std::thread( work ) );
+    }
+    work();
+    for ( unsigned int t = 0; t < pool.size(); t++ ) {
+        pool[t].join();
+    }
+
+    if ( !words ) return;
+
+    // textStart holds offsets within each chunk until now
+    for ( unsigned int c = 0; c < chunks; c++ ) {
+        size_t base = results->text.size();
+        unsigned int last = std::min( n, ( c + 1 ) * CHUNK_BOARDS );
+        for ( unsigned int b = c * CHUNK_BOARDS; b < last; b++ ) {
+            results->textStart[b+1] += base;
+        }
+        results->text.insert( results->text.end(),
+                              chunkText[c].begin(), chunkText[c].end() );
+    }
+}
+
+template void solveBatch<TST>( const BoardBatch&, const TST&, unsigned int,
+                               BatchResults*, bool, unsigned int );
+template void solveBatch<DAWG>( const BoardBatch&, const DAWG&, unsigned int,
+                                BatchResults*, bool, unsigned int );
@@ -0,0 +1,162 @@
+#ifndef BOGGLEBATCH_H
+#define BOGGLEBATCH_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+#include "boggleutil.h"
+#include "bogglegrid.h"
+
+using std::vector;
+using std::string;
+
+/**
+ * Header at the start of a board batch file.
+ *
+ * It is followed directly by count board records, exactly as a
+ * BoardBatch holds them in memory, so reading a file is one copy
+ * and an index of the records. Batch files are native-endian;
+ * byteOrder rejects files from other hosts.
+ */
+struct BatchHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int byteOrder;
+    unsigned int count;
+};
+
+/**
+ * Represents many boards, one after another in one buffer.
+ *
+ * A board is a record of its rows and columns, as two bytes each,
+ * followed by its faces, row by row, each as a length byte and its
+ * characters, as BoardGrid::assign() takes them packed. A 4x4
+ * board of single letters takes 36 bytes.
+ */
+class BoardBatch {
+
+private:
+    vector<unsigned char> data;
+    vector<size_t> starts;
+
+    /**
+     * Indexes the records in data, checking that they fill it.
+     *
+     * Returns false, leaving the batch empty, if they do not.
+     */
+    bool index(unsigned int count);
+
+public:
+    // largest rows, columns and face length a record holds
+    static const unsigned int MAX_SIDE = 65535;
+    static const unsigned int MAX_FACE = 255;
+
+    /**
+     * Removes every board, keeping the capacity.
+     */
+    void clear();
+
+    /**
+     * Adds a board, given as setBoard() takes it.
+     *
+     * Returns false, adding nothing, if a side or a face is too
+     * long for a record.
+     */
+    bool add(unsigned int rows, unsigned int cols, string** dice);
+
+    /**
+     * Returns the number of boards.
+     */
+    unsigned int size() const { return starts.size(); }
+
+    /**
+     * Returns the number of rows of a board.
+     */
+    unsigned int rows(unsigned int b) const;
+
+    /**
+     * Returns the number of columns of a board.
+     */
+    unsigned int cols(unsigned int b) const;
+
+    /**
+     * Returns the packed faces of a board.
+     */
+    const unsigned char* faces(unsigned int b) const {
+        return &data[ starts[b] + 4 ];
+    }
+
+    /**
+     * Reads a batch file written by write(), replacing the boards.
+     *
+     * Returns false, leaving the batch empty, if the file cannot
+     * be read or was written by another version or host.
+     */
+    bool read(const char* path);
+
+    /**
+     * Writes the boards to a batch file.
+     *
+     * Returns false if the file cannot be written.
+     */
+    bool write(const char* path) const;
+
+    /**
+     * Parses boards in the brd.txt format, one after another,
+     * replacing the boards: the rows, the columns and then every
+     * face, row by row, all separated by white space.
+     *
+     * Returns false, leaving the batch empty, if a board is cut
+     * short or a record cannot hold it.
+     */
+    bool parse(const char* text, size_t length);
+
+    /**
+     * Reads a file of boards in the brd.txt format, as parse()
+     * does.
+     *
+     * Returns false, leaving the batch empty, if the file cannot be
+     * read or parsed.
+     */
+    bool readText(const char* path);
+
+};
+
+/**
+ * Holds what solveBatch() found on each board of a BoardBatch.
+ *
+ * counts[b] and scores[b] are the number of words on board b and
+ * their score. If the words were asked for, those of board b are
+ * text[textStart[b]] up to text[textStart[b+1]], each followed by
+ * a newline, in the order the search found them.
+ */
+struct BatchResults {
+    vector<unsigned int> counts;
+    vector<unsigned int> scores;
+    vector<char> text;
+    vector<size_t> textStart;
+};
+
+/**
+ * Returns the points a word of the specified number of letters
+ * scores under the standard rules: 1 for 3 or 4, 2 for 5, 3 for
+ * 6, 5 for 7 and 11 for 8 or more.
+ */
+unsigned int scoreWord(unsigned int length);
+
+/**
+ * Finds the words of at least min letters which a lexicon holds on
+ * every board of a batch, into results, keeping the words as well
+ * if words is set.
+ *
+ * L is TST or DAWG. threads threads take the boards a chunk at a
+ * time, each with its own board, searches and sink, built once and
+ * reused for every board it solves; 4x4 and 5x5 boards go to their
+ * FixedSearch. The results do not depend on the number of threads.
+ */
+template<class L>
+void solveBatch(const BoardBatch& boards, const L& lex, unsigned int min,
+                BatchResults* results, bool words, unsigned int threads);
+
+#endif // BOGGLEBATCH_H
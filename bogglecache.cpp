@@ -0,0 +1,230 @@
+#include "bogglecache.h"
+
+const unsigned int ResultCache::NONE;
+
+/**
+ * Appends a number to a key, seven bits to a byte, the low bits
+ * first, with the top bit set on every byte but the last.
+ */
+static void appendNumber( string& out, unsigned int n ) {
+    while ( n >= 0x80 ) {
+        out += (char)( ( n & 0x7f ) | 0x80 );
+        n >>= 7;
+    }
+    out += (char)n;
+}
+
+/**
+ * Returns the cell of a board of rows rows and cols columns that
+ * lands on row i and column j once the board is turned and
+ * mirrored by a symmetry.
+ *
+ * Bit 2 of a symmetry swaps rows and columns, and bits 0 and 1
+ * then reverse the rows and the columns; the 8 together are every
+ * turn and mirror of the board.
+ */
+static unsigned int sourceCell( unsigned int rows, unsigned int cols,
+                                unsigned int symmetry,
+                                unsigned int i, unsigned int j ) {
+    unsigned int r = ( symmetry & 4 ) ? j : i;
+    unsigned int c = ( symmetry & 4 ) ? i : j;
+
+    if ( symmetry & 1 ) r = rows - 1 - r;
+    if ( symmetry & 2 ) c = cols - 1 - c;
+    return r * cols + c;
+}
+
+/**
+ * Constructs a ResultCache holding no boards.
+ */
+ResultCache::ResultCache()
+    : capacity(0), first(NONE), last(NONE), pending(NONE), serial(0),
+      hitCount(0), missCount(0) {}
+
+/**
+ * Sets how many boards the cache holds, dropping every board and
+ * zeroing the counters.
+ */
+void ResultCache::setCapacity( unsigned int boards ) {
+    clear();
+    capacity = boards;
+    hitCount = 0;
+    missCount = 0;
+}
+
+/**
+ * Drops every board.
+ */
+void ResultCache::clear() {
+    entries.clear();
+    index.clear();
+    first = NONE;
+    last = NONE;
+    pending = NONE;
+}
+
+/**
+ * Writes the key of a board turned and mirrored by a symmetry to
+ * out.
+ */
+void ResultCache::keyOf( const BoardGrid& grid, unsigned int symmetry,
+                         string& out ) {
+    unsigned int rows = ( symmetry & 4 ) ? grid.cols : grid.rows;
+    unsigned int cols = ( symmetry & 4 ) ? grid.rows : grid.cols;
+
+    out.clear();
+    appendNumber( out, rows );
+    appendNumber( out, cols );
+    for ( unsigned int i = 0; i < rows; i++ ) {
+        for ( unsigned int j = 0; j < cols; j++ ) {
+            const string& f = grid.faceAt(
+                sourceCell( grid.rows, grid.cols, symmetry, i, j ) );
+            appendNumber( out, f.length() );
+            out += f;
+        }
+    }
+}
+
+/**
+ * Takes an entry out of the order of use.
+ */
+void ResultCache::unlink( unsigned int e ) {
+    CacheEntry& entry = entries[e];
+
+    if ( entry.prev != NONE ) entries[ entry.prev ].next = entry.next;
+    else first = entry.next;
+    if ( entry.next != NONE ) entries[ entry.next ].prev = entry.prev;
+    else last = entry.prev;
+}
+
+/**
+ * Puts an entry first in the order of use.
+ */
+void ResultCache::pushFront( unsigned int e ) {
+    entries[e].prev = NONE;
+    entries[e].next = first;
+    if ( first != NONE ) entries[first].prev = e;
+    else last = e;
+    first = e;
+}
+
+/**
+ * Looks a board up, for the lexicon version of the specified
+ * serial, passing its words of at least min letters to sink if it
+ * is held.
+ *
+ * Returns false on a miss.
+ */
+bool ResultCache::lookup( const BoardGrid& grid, unsigned long long serial,
+                          unsigned int min, WordSink* sink ) {
+    unordered_map<string, unsigned int>::iterator it;
+    unsigned int best = 0, e;
+
+    if ( serial != this->serial ) {
+        clear();
+        this->serial = serial;
+    }
+
+    keyOf( grid, 0, key );
+    for ( unsigned int s = 1; s < 8; s++ ) {
+        keyOf( grid, s, variant );
+        if ( variant < key ) {
+            key.swap( variant );
+            best = s;
+        }
+    }
+
+    // order takes a cell of the canonical board to the caller's,
+    // and place back
+    order.resize( grid.size );
+    place.resize( grid.size );
+    path.resize( grid.size );
+    {
+        unsigned int rows = ( best & 4 ) ? grid.cols : grid.rows;
+        unsigned int cols = ( best & 4 ) ? grid.rows : grid.cols;
+        for ( unsigned int i = 0, k = 0; i < rows; i++ ) {
+            for ( unsigned int j = 0; j < cols; j++, k++ ) {
+                order[k] = sourceCell( grid.rows, grid.cols, best, i, j );
+                place[ order[k] ] = k;
+            }
+        }
+    }
+
+    it = index.find( key );
+    if ( it != index.end() ) {
+        const CacheEntry& entry = entries[ it->second ];
+        hitCount++;
+        unlink( it->second );
+        pushFront( it->second );
+        for ( unsigned int w = 0, t = 0, c = 0; w < entry.textEnd.size();
+                                                w++ ) {
+            unsigned int length = entry.textEnd[w] - t;
+            unsigned int cells = entry.cellEnd[w] - c;
+            if ( length >= min ) {
+                for ( unsigned int k = 0; k < cells; k++ ) {
+                    path[k] = order[ entry.cells[ c + k ] ];
+                }
+                sink->word( &entry.text[t], length, path.data(), cells );
+            }
+            t = entry.textEnd[w];
+            c = entry.cellEnd[w];
+        }
+        return 1;
+    }
+    missCount++;
+
+    // the entry to record into, out of the order of use until
+    // store(); the oldest board makes way once the cache is full
+    if ( pending != NONE ) {
+        e = pending;
+    }
+    else if ( entries.size() < capacity ) {
+        e = entries.size();
+        entries.push_back( CacheEntry() );
+    }
+    else {
+        e = last;
+        unlink( e );
+        index.erase( entries[e].key );
+    }
+    pending = e;
+    entries[e].key = key;
+    entries[e].text.clear();
+    entries[e].textEnd.clear();
+    entries[e].cells.clear();
+    entries[e].cellEnd.clear();
+    return 0;
+}
+
+/**
+ * Makes the entry recorded since the last lookup the newest,
+ * dropping the oldest if the cache is full.
+ */
+void ResultCache::store() {
+    if ( pending == NONE ) return;
+
+    index[ entries[pending].key ] = pending;
+    pushFront( pending );
+    pending = NONE;
+}
+
+/**
+ * Keeps a word and its path in the entry being recorded, and
+ * passes it on if it is long enough.
+ */
+void ResultCache::Recorder::word( const char* data, unsigned int length,
+                                  const unsigned int* path,
+                                  unsigned int cells ) {
+    if ( cache->pending != NONE ) {
+        CacheEntry& entry = cache->entries[ cache->pending ];
+        entry.text.insert( entry.text.end(), data, data + length );
+        entry.textEnd.push_back( entry.text.size() );
+        for ( unsigned int k = 0; k < cells; k++ ) {
+            entry.cells.push_back( cache->place[ path[k] ] );
+        }
+        entry.cellEnd.push_back( entry.cells.size() );
+    }
+    if ( length >= min ) {
+        sink->word( data, length, path, cells );
+    }
+}
@@ -0,0 +1,160 @@
+#ifndef BOGGLECACHE_H
+#define BOGGLECACHE_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "bogglegrid.h"
+
+using std::vector;
+using std::string;
+using std::unordered_map;
+
+/**
+ * Keeps the words found on the boards solved most recently, with
+ * their paths, so a board seen again is answered without a search.
+ *
+ * A board turned or mirrored has the same words, along the turned
+ * or mirrored paths, so a board is looked up by the smallest of
+ * the keys of its 8 turns and mirrors, and its paths are kept in
+ * the cells of that orientation and mapped back to the caller's.
+ * A key is the shape and the faces, cell by cell, so boards only
+ * share an entry if they are the same board. Entries are linked
+ * in the order they were last used, by index, and once the cache
+ * holds as many boards as its capacity, the one unused longest
+ * is dropped; its buffers keep their capacity for the next board.
+ * Words are kept from a solve with no minimum length, and those
+ * too short for a later lookup are left out then.
+ */
+class ResultCache {
+
+private:
+    static const unsigned int NONE = 0xffffffff;
+
+    /**
+     * The words of one board: word w is text[textEnd[w-1]] up to
+     * text[textEnd[w]], found along cells[cellEnd[w-1]] up to
+     * cells[cellEnd[w]], in the canonical orientation.
+     */
+    struct CacheEntry {
+        string key;
+        vector<char> text;
+        vector<unsigned int> textEnd;
+        vector<unsigned int> cells;
+        vector<unsigned int> cellEnd;
+        unsigned int prev;
+        unsigned int next;
+    };
+
+    vector<CacheEntry> entries;
+    unordered_map<string, unsigned int> index;
+    unsigned int capacity;
+    unsigned int first;
+    unsigned int last;
+    unsigned int pending;
+    unsigned long long serial;
+    unsigned long long hitCount;
+    unsigned long long missCount;
+    string key;
+    string variant;
+    vector<unsigned int> order;
+    vector<unsigned int> place;
+    vector<unsigned int> path;
+
+    /**
+     * Writes the key of a board turned and mirrored by a symmetry
+     * to out.
+     */
+    void keyOf(const BoardGrid& grid, unsigned int symmetry, string& out);
+
+    /**
+     * Takes an entry out of the order of use.
+     */
+    void unlink(unsigned int e);
+
+    /**
+     * Puts an entry first in the order of use.
+     */
+    void pushFront(unsigned int e);
+
+public:
+    /**
+     * Passes the words of a search on to another sink, and keeps
+     * every word, with its path, in the entry for the board a
+     * lookup missed.
+     */
+    class Recorder : public WordSink {
+
+    private:
+        ResultCache* cache;
+        unsigned int min;
+        WordSink* sink;
+
+    public:
+        /**
+         * Constructs a Recorder passing the words of at least min
+         * letters to sink.
+         */
+        Recorder(ResultCache* cache, unsigned int min, WordSink* sink)
+            : cache(cache), min(min), sink(sink) {}
+
+        void word(const char* data, unsigned int length,
+                  const unsigned int* path, unsigned int cells);
+
+    };
+
+    /**
+     * Constructs a ResultCache holding no boards.
+     */
+    ResultCache();
+
+    /**
+     * Sets how many boards the cache holds, dropping every board
+     * and zeroing the counters.
+     *
+     * 0 turns the cache off.
+     */
+    void setCapacity(unsigned int boards);
+
+    /**
+     * Returns how many boards the cache holds.
+     */
+    unsigned int getCapacity() const { return capacity; }
+
+    /**
+     * Drops every board.
+     */
+    void clear();
+
+    /**
+     * Looks a board up, for the lexicon version of the specified
+     * serial, passing its words of at least min letters to sink
+     * if it is held.
+     *
+     * Returns false on a miss; the words of a search of the board
+     * passed through a Recorder, followed by store(), then make
+     * its entry. A lookup for another lexicon drops every board.
+     */
+    bool lookup(const BoardGrid& grid, unsigned long long serial,
+                unsigned int min, WordSink* sink);
+
+    /**
+     * Makes the entry recorded since the last lookup the newest,
+     * dropping the oldest if the cache is full.
+     */
+    void store();
+
+    /**
+     * Returns how many lookups found their board.
+     */
+    unsigned long long hits() const { return hitCount; }
+
+    /**
+     * Returns how many lookups did not find their board.
+     */
+    unsigned long long misses() const { return missCount; }
+
+};
+
+#endif // BOGGLECACHE_H
@@ -0,0 +1,317 @@
+#include "boggledawg.h"
+
+const unsigned int DAWG::LABEL_MASK;
+const unsigned int DAWG::END_BIT;
+const unsigned int DAWG::LAST_BIT;
+const unsigned int DAWG::TARGET_SHIFT;
+
+// largest state index that fits in a packed edge
+static const unsigned int MAX_INDEX = 0x3fffff;
+
+// lookups in flight at once in findMany()
+static const unsigned int BATCH_LANES = 16;
+
+/**
+ * Clears the DAWG.
+ */
+void DAWG::clear() {
+    vector<unsigned int>().swap( edges );
+    base = nullptr;
+    count = 0;
+    root = 0;
+}
+
+/**
+ * Finds whether a specified string is in the DAWG.
+ *
+ * Returns true if the string is in the DAWG and false otherwise.
+ */
+bool DAWG::find( const string& str ) {
+    LexiconCursor cursor;
+    return advance( cursor, str.data(), str.length() ) && cursor.end;
+}
+
+/**
+ * Finds which of the specified strings are in the DAWG.
+ *
+ * Sets hits[i] to whether words[i] is in the DAWG. Several
+ * lookups advance in lockstep, each prefetching its next state
+ * while the others take their step.
+ */
+void DAWG::findMany( const string* words, unsigned int count,
+                                        vector<bool>& hits ) {
+    struct Lane {
+        const char *str;
+        unsigned int length;
+        unsigned int pos;
+        unsigned int state;
+        unsigned int word;
+    } lanes[BATCH_LANES];
+    unsigned int active = 0, next = 0;
+
+    hits.assign( count, 0 );
+    if ( count == 0 || root == 0 ) return;
+
+    while ( 1 ) {
+        // refills free lanes; empty words are never found
+        while ( active < BATCH_LANES && next < count ) {
+            if ( words[next].length() > 0 ) {
+                Lane& l = lanes[active++];
+                l.str = words[next].data();
+                l.length = words[next].length();
+                l.pos = 0;
+                l.state = root;
+                l.word = next;
+            }
+            next++;
+        }
+        if ( active == 0 ) break;
+
+        // one state for every lane; a finished lane is replaced by
+        // the last one
+        for ( unsigned int i = 0; i < active; ) {
+            Lane& l = lanes[i];
+            unsigned char c = l.str[l.pos];
+            unsigned int e = l.state;
+            while ( ( base[e] & LABEL_MASK ) != c
+                               && !( base[e] & LAST_BIT ) ) {
+                e++;
+            }
+            if ( ( base[e] & LABEL_MASK ) != c ) {
+                l = lanes[--active];
+                continue;
+            }
+            l.pos++;
+            if ( l.pos == l.length ) {
+                hits[l.word] = ( base[e] & END_BIT ) != 0;
+                l = lanes[--active];
+                continue;
+            }
+            l.state = base[e] >> TARGET_SHIFT;
+            if ( l.state == 0 ) {
+                l = lanes[--active];
+                continue;
+            }
+            __builtin_prefetch( &base[l.state] );
+            i++;
+        }
+    }
+}
+
+/**
+ * Judges whether a specified string is a prefix in the DAWG.
+ *
+ * Returns true if the string is a prefix and false otherwise.
+ */
+bool DAWG::isPrefix( const string& str ) {
+    LexiconCursor cursor;
+    return advance( cursor, str.data(), str.length() );
+}
+
+/**
+ * Judges whether the DAWG is empty.
+ */
+bool DAWG::isEmpty() {
+    return root == 0;
+}
+
+/**
+ * Appends every word in the DAWG to text, one per line, in
+ * sorted order.
+ */
+void DAWG::listWords( vector<char>& text ) {
+    string prefix;
+    if ( root != 0 ) {
+        listFrom( root, prefix, text );
+    }
+}
+
+/**
+ * Appends the words reachable from a state, each after the
+ * given prefix, to text.
+ *
+ * Edges of a state are stored in label order, so the words come
+ * out sorted.
+ */
+void DAWG::listFrom( unsigned int state, string& prefix,
+                           vector<char>& text ) const {
+    for ( unsigned int e = state; ; e++ ) {
+        prefix.push_back( (char)( base[e] & LABEL_MASK ) );
+        if ( base[e] & END_BIT ) {
+            text.insert( text.end(), prefix.begin(), prefix.end() );
+            text.push_back( '\n' );
+        }
+        if ( ( base[e] >> TARGET_SHIFT ) != 0 ) {
+            listFrom( base[e] >> TARGET_SHIFT, prefix, text );
+        }
+        prefix.resize( prefix.length() - 1 );
+        if ( base[e] & LAST_BIT ) break;
+    }
+}
+
+/**
+ * Returns the number of edges in the DAWG.
+ */
+unsigned int DAWG::size() {
+    return count;
+}
+
+/**
+ * Returns the edges, in the layout written to snapshots.
+ */
+const unsigned int* DAWG::data() {
+    return base;
+}
+
+/**
+ * Returns the index of the root state.
+ */
+unsigned int DAWG::getRoot() {
+    return root;
+}
+
+/**
+ * Makes the DAWG read edges in place from external memory,
+ * such as a mapped snapshot, which must outlive the DAWG or
+ * the next clear().
+ *
+ * Returns false, leaving the DAWG as it was, if the root or an
+ * edge target points past the last edge, or the last state runs
+ * off the end.
+ */
+bool DAWG::attach( const unsigned int* edges,
+                   unsigned int count,
+                   unsigned int root ) {
+    // checked once here, so lookups never leave the edges
+    if ( root >= count || !( edges[count - 1] & LAST_BIT ) ) return 0;
+    for ( unsigned int i = 0; i < count; i++ ) {
+        if ( ( edges[i] >> TARGET_SHIFT ) >= count ) return 0;
+    }
+
+    clear();
+    this->base = edges;
+    this->count = count;
+    this->root = root;
+    return 1;
+}
+
+/**
+ * Constructs a DAWGBuilder which writes into the given DAWG.
+ *
+ * The DAWG is cleared first.
+ */
+DAWGBuilder::DAWGBuilder( DAWG* dawg ) : dawg(dawg), failed(0) {
+    dawg->clear();
+    // sentinel, so that no real state starts at index 0
+    dawg->edges.push_back( DAWG::LAST_BIT );
+    path.resize( 1 );
+}
+
+/**
+ * Returns the frozen state equivalent to the given edges.
+ */
+unsigned int DAWGBuilder::intern( const vector<PendingEdge>& out ) {
+    string key;
+    unsigned int id;
+
+    if ( out.empty() ) return 0;
+
+    for ( int i = 0; i < (int)( out.size() ); i++ ) {
+        key += out[i].label;
+        key += (char)out[i].end;
+        key.append( (const char*)&out[i].target, sizeof( unsigned int ) );
+    }
+
+    unordered_map<string, unsigned int>::iterator it = registry.find( key );
+    if ( it != registry.end() ) {
+        return it->second;
+    }
+
+    id = dawg->edges.size();
+    if ( id + out.size() > MAX_INDEX ) {
+        failed = 1;
+        return 0;
+    }
+
+    for ( int i = 0; i < (int)( out.size() ); i++ ) {
+        unsigned int e = (unsigned char)out[i].label;
+        if ( out[i].end ) e |= DAWG::END_BIT;
+        if ( i + 1 == (int)( out.size() ) ) e |= DAWG::LAST_BIT;
+        e |= out[i].target << DAWG::TARGET_SHIFT;
+        dawg->edges.push_back( e );
+    }
+
+    registry.insert( make_pair( key, id ) );
+    return id;
+}
+
+/**
+ * Freezes the mutable path below the specified depth.
+ */
+void DAWGBuilder::freeze( unsigned int depth ) {
+    for ( int d = (int)( path.size() ) - 1; d > (int)depth; d-- ) {
+        path[d-1].back().target = intern( path[d] );
+    }
+    path.resize( depth + 1 );
+}
+
+/**
+ * Adds a word.
+ *
+ * Returns false if the word does not sort strictly after the
+ * previous one, or if the DAWG has outgrown its 22-bit state
+ * indices. Empty words are ignored.
+ */
+bool DAWGBuilder::add( const char* word, unsigned int length ) {
+    unsigned int common = 0;
+
+    if ( failed ) return 0;
+    if ( length == 0 ) return 1;
+
+    if ( previous.compare( 0, string::npos, word, length ) >= 0 ) {
+        failed = 1;
+        return 0;
+    }
+
+    while ( common < previous.length() && common < length
+                             && previous[common] == word[common] ) {
+        common++;
+    }
+
+    freeze( common );
+
+    for ( unsigned int i = common; i < length; i++ ) {
+        PendingEdge e;
+        e.label = word[i];
+        e.end = ( i + 1 == length );
+        e.target = 0;
+        path[i].push_back( e );
+        path.push_back( vector<PendingEdge>() );
+    }
+
+    previous.assign( word, length );
+    return !failed;
+}
+
+/**
+ * Freezes the remaining states and finishes the DAWG.
+ *
+ * Returns false if any add() failed, in which case the DAWG is
+ * left empty.
+ */
+bool DAWGBuilder::finish() {
+    freeze( 0 );
+    dawg->root = intern( path[0] );
+    path.clear();
+    unordered_map<string, unsigned int>().swap( registry );
+
+    if ( failed ) {
+        dawg->clear();
+        return 0;
+    }
+
+    vector<unsigned int>( dawg->edges ).swap( dawg->edges );
+    dawg->base = dawg->edges.data();
+    dawg->count = dawg->edges.size();
+    return 1;
+}
@@ -0,0 +1,231 @@
+#ifndef BOGGLEDAWG_H
+#define BOGGLEDAWG_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "boggleutil.h"
+
+using std::vector;
+using std::string;
+using std::unordered_map;
+
+/**
+ * Represents a Directed Acyclic Word Graph, the minimal acyclic
+ * automaton accepting exactly the lexicon.
+ *
+ * Every state is a run of consecutive edges in one flat array and
+ * is identified by the index of its first edge. An edge packs its
+ * label, an end-of-word flag, a last-edge-of-state flag and the
+ * target state into 32 bits. Index 0 holds a sentinel edge, so a
+ * target of 0 means the edge leads nowhere. Lookups go through
+ * base, which points either at the owned edges or at edges
+ * attached from a mapped snapshot.
+ */
+class DAWG : public Lexicon {
+
+private:
+    // layout of a packed edge
+    static const unsigned int LABEL_MASK = 0xff;
+    static const unsigned int END_BIT = 1u << 8;
+    static const unsigned int LAST_BIT = 1u << 9;
+    static const unsigned int TARGET_SHIFT = 10;
+
+    vector<unsigned int> edges;
+    const unsigned int *base;
+    unsigned int count;
+    unsigned int root;
+
+    friend class DAWGBuilder;
+
+    /**
+     * Appends the words reachable from a state, each after the
+     * given prefix, to text.
+     */
+    void listFrom(unsigned int state, string& prefix,
+                  vector<char>& text) const;
+
+public:
+    /**
+     * Constructs an empty DAWG.
+     */
+    DAWG() : base(nullptr), count(0), root(0) {}
+
+    /**
+     * Clears the DAWG.
+     */
+    void clear();
+
+    /**
+     * Finds whether a specified string is in the DAWG.
+     *
+     * Returns true if the string is in the DAWG and false otherwise.
+     */
+    bool find(const string& str);
+
+    /**
+     * Finds which of the specified strings are in the DAWG.
+     *
+     * Sets hits[i] to whether words[i] is in the DAWG. Several
+     * lookups advance in lockstep, each prefetching its next state
+     * while the others take their step.
+     */
+    void findMany(const string* words, unsigned int count,
+                  vector<bool>& hits);
+
+    /**
+     * Judges whether a specified string is a prefix in the DAWG.
+     *
+     * Returns true if the string is a prefix and false otherwise.
+     */
+    bool isPrefix(const string& str);
+
+    /**
+     * Advances a cursor by the specified characters.
+     *
+     * Returns false if the cursor's prefix followed by the
+     * characters is not a prefix in the DAWG; the cursor is then
+     * left in an unspecified state.
+     */
+    bool advance(LexiconCursor& cursor, const char* s, unsigned int n) const;
+
+    /**
+     * Judges whether the DAWG is empty.
+     */
+    bool isEmpty();
+
+    /**
+     * Appends every word in the DAWG to text, one per line, in
+     * sorted order.
+     */
+    void listWords(vector<char>& text);
+
+    /**
+     * Returns the number of edges in the DAWG.
+     */
+    unsigned int size();
+
+    /**
+     * Returns the edges, in the layout written to snapshots.
+     */
+    const unsigned int* data();
+
+    /**
+     * Returns the index of the root state.
+     */
+    unsigned int getRoot();
+
+    /**
+     * Makes the DAWG read edges in place from external memory,
+     * such as a mapped snapshot, which must outlive the DAWG or
+     * the next clear().
+     *
+     * Returns false, leaving the DAWG as it was, if the root or an
+     * edge target points past the last edge, or the last state
+     * runs off the end.
+     */
+    bool attach(const unsigned int* edges, unsigned int count,
+                                            unsigned int root);
+
+};
+
+/**
+ * Builds a DAWG from words added in sorted order.
+ *
+ * Uses the incremental construction for sorted input: only the
+ * path of the most recently added word is kept mutable, and each
+ * state is frozen into the output, or merged with an identical
+ * state frozen earlier, as soon as no later word can reach it.
+ * The build is linear in the total length of the input.
+ */
+class DAWGBuilder {
+
+private:
+    /**
+     * An outgoing edge of a state on the mutable path.
+     */
+    struct PendingEdge {
+        char label;
+        bool end;
+        unsigned int target;
+    };
+
+    vector< vector<PendingEdge> > path;
+    string previous;
+    unordered_map<string, unsigned int> registry;
+    DAWG* dawg;
+    bool failed;
+
+    /**
+     * Freezes the mutable path below the specified depth.
+     */
+    void freeze(unsigned int depth);
+
+    /**
+     * Returns the frozen state equivalent to the given edges.
+     */
+    unsigned int intern(const vector<PendingEdge>& out);
+
+public:
+    /**
+     * Constructs a DAWGBuilder which writes into the given DAWG.
+     *
+     * The DAWG is cleared first.
+     */
+    DAWGBuilder(DAWG* dawg);
+
+    /**
+     * Adds a word.
+     *
+     * Returns false if the word does not sort strictly after the
+     * previous one, or if the DAWG has outgrown its 22-bit state
+     * indices. Empty words are ignored.
+     */
+    bool add(const char* word, unsigned int length);
+
+    /**
+     * Freezes the remaining states and finishes the DAWG.
+     *
+     * Returns false if any add() failed, in which case the DAWG is
+     * left empty.
+     */
+    bool finish();
+
+};
+
+/**
+ * Advances a cursor by the specified characters.
+ *
+ * Returns false if the cursor's prefix followed by the
+ * characters is not a prefix in the DAWG; the cursor is then
+ * left in an unspecified state.
+ */
+inline bool DAWG::advance( LexiconCursor& cursor,
+                           const char* s,
+                           unsigned int n ) const {
+    unsigned int e;
+
+    if ( n == 0 ) return 1;
+
+    for ( unsigned int i = 0; i < n; i++ ) {
+        unsigned char c = s[i];
+        if ( cursor.pos == LexiconCursor::ROOT ) {
+            e = root;
+        }
+        else {
+            e = base[cursor.pos] >> TARGET_SHIFT;
+        }
+        if ( e == 0 ) return 0;
+        while ( ( base[e] & LABEL_MASK ) != c ) {
+            if ( base[e] & LAST_BIT ) return 0;
+            e++;
+        }
+        cursor.pos = e;
+    }
+
+    cursor.end = ( base[cursor.pos] & END_BIT ) != 0;
+    return 1;
+}
+
+#endif // BOGGLEDAWG_H
@@ -0,0 +1,118 @@
+#include "bogglefilter.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// largest count a signature field holds
+static const unsigned int MAX_COUNT = 7;
+
+// field shared by every character other than a-z
+static const unsigned int OTHER = 26;
+
+/**
+ * Adds the specified characters.
+ */
+void LetterSignature::add( const char* s, unsigned int n ) {
+    for ( unsigned int i = 0; i < n; i++ ) {
+        unsigned int f = (unsigned char)( s[i] - 'a' );
+        if ( f >= OTHER ) f = OTHER;
+
+        unsigned long long& word = counts[f / 16];
+        unsigned int shift = ( f % 16 ) * 4;
+        if ( ( ( word >> shift ) & 0xf ) < MAX_COUNT ) {
+            word += 1ull << shift;
+        }
+        mask |= 1u << f;
+    }
+}
+
+/**
+ * Replaces the words with those of a lexicon, and computes
+ * their signatures.
+ */
+void LexiconFilter::build( Lexicon& lexicon ) {
+    const char *p, *end, *line;
+
+    text.clear();
+    refs.clear();
+    masks.clear();
+    counts.clear();
+
+    lexicon.listWords( text );
+
+    // text is complete, so references into it stay valid
+    p = text.data();
+    end = p + text.size();
+    while ( p < end ) {
+        line = p;
+        while ( *p != '\n' ) p++;
+
+        WordRef ref = { line, (unsigned int)( p - line ) };
+        LetterSignature sig;
+        sig.add( ref.data, ref.length );
+
+        refs.push_back( ref );
+        masks.push_back( sig.mask );
+        counts.push_back( sig.counts[0] );
+        counts.push_back( sig.counts[1] );
+        p++;
+    }
+}
+
+/**
+ * Returns the number of words.
+ */
+unsigned int LexiconFilter::size() const {
+    return refs.size();
+}
+
+/**
+ * Collects the words whose letters the board covers, in sorted
+ * order, into out.
+ *
+ * Returns false, leaving out unspecified, as soon as more than
+ * limit words pass.
+ */
+bool LexiconFilter::select( const LetterSignature& board,
+                            unsigned int limit,
+                            vector<WordRef>& out ) const {
+    unsigned int n = refs.size(), i = 0;
+    unsigned int missing = ~board.mask;
+    LetterSignature word;
+
+    out.clear();
+
+    // checks the counts of a word whose letters all occur
+    auto check = [&]( unsigned int k ) {
+        word.counts[0] = counts[2*k];
+        word.counts[1] = counts[2*k+1];
+        if ( board.covers( word ) ) {
+            out.push_back( refs[k] );
+        }
+    };
+
+#ifdef __SSE2__
+    // letter masks four at a time; almost every word fails here
+    __m128i miss = _mm_set1_epi32( (int)missing );
+    __m128i zero = _mm_setzero_si128();
+    for ( ; i + 4 <= n; i += 4 ) {
+        __m128i m = _mm_loadu_si128( (const __m128i*)&masks[i] );
+        __m128i ok = _mm_cmpeq_epi32( _mm_and_si128( m, miss ), zero );
+        int bits = _mm_movemask_ps( _mm_castsi128_ps( ok ) );
+        while ( bits != 0 ) {
+            check( i + __builtin_ctz( bits ) );
+            bits &= bits - 1;
+        }
+        if ( out.size() > limit ) return 0;
+    }
+#endif
+
+    for ( ; i < n; i++ ) {
+        if ( ( masks[i] & missing ) == 0 ) {
+            check( i );
+        }
+    }
+
+    return out.size() <= limit;
+}
@@ -0,0 +1,110 @@
+#ifndef BOGGLEFILTER_H
+#define BOGGLEFILTER_H
+
+#include <vector>
+
+#include "boggleutil.h"
+
+using std::vector;
+
+/**
+ * Represents the letters of a word, or of all the dice on a board,
+ * in a form which can be compared in a few instructions.
+ *
+ * Letters a-z are numbered 0-25 and every other character shares
+ * number 26. Bit k of mask is set if letter k occurs; counts packs
+ * how often each letter occurs into 4-bit fields, 16 to a word,
+ * saturating at 7.
+ */
+struct LetterSignature {
+    unsigned int mask;
+    unsigned long long counts[2];
+
+    /**
+     * Constructs the signature of no letters.
+     */
+    LetterSignature() : mask(0) { counts[0] = counts[1] = 0; }
+
+    /**
+     * Adds the specified characters.
+     */
+    void add(const char* s, unsigned int n);
+
+    /**
+     * Judges whether every letter of another signature occurs here
+     * at least as often.
+     */
+    bool covers(const LetterSignature& other) const;
+
+};
+
+/**
+ * Represents the words of a lexicon together with their letter
+ * signatures, for cutting the lexicon down to one board.
+ *
+ * A word can only be on a board if the board's dice hold all of
+ * its letters, as often as the word uses them; a die with several
+ * letters, such as "Qu", counts towards each of them. Most of the
+ * lexicon fails that test for a small board, and the rest makes a
+ * much smaller lexicon to search.
+ *
+ * Signatures are stored as parallel arrays, so the letter masks
+ * can be scanned several words at a time.
+ */
+class LexiconFilter {
+
+private:
+    vector<char> text;
+    vector<WordRef> refs;
+    vector<unsigned int> masks;
+    vector<unsigned long long> counts;
+
+    LexiconFilter(const LexiconFilter&);
+    LexiconFilter& operator=(const LexiconFilter&);
+
+public:
+    /**
+     * Constructs an empty LexiconFilter.
+     */
+    LexiconFilter() {}
+
+    /**
+     * Replaces the words with those of a lexicon, and computes
+     * their signatures.
+     */
+    void build(Lexicon& lexicon);
+
+    /**
+     * Returns the number of words.
+     */
+    unsigned int size() const;
+
+    /**
+     * Collects the words whose letters the board covers, in sorted
+     * order, into out.
+     *
+     * Returns false, leaving out unspecified, as soon as more than
+     * limit words pass; the board then rules out too little of the
+     * lexicon for a smaller one to pay off.
+     */
+    bool select(const LetterSignature& board, unsigned int limit,
+                vector<WordRef>& out) const;
+
+};
+
+/**
+ * Judges whether every letter of another signature occurs here
+ * at least as often.
+ */
+inline bool LetterSignature::covers( const LetterSignature& other ) const {
+    // with the top bit of each field set, subtracting a count of
+    // at most 7 never borrows from the next field, and leaves the
+    // top bit set exactly where this count is at least as large
+    const unsigned long long HIGH = 0x8888888888888888ull;
+
+    return ( other.mask & ~mask ) == 0
+        && ( ( ( counts[0] | HIGH ) - other.counts[0] ) & HIGH ) == HIGH
+        && ( ( ( counts[1] | HIGH ) - other.counts[1] ) & HIGH ) == HIGH;
+}
+
+#endif // BOGGLEFILTER_H
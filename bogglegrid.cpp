@@ -0,0 +1,1129 @@
+#include "bogglegrid.h"
+#include "boggledawg.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+const unsigned int BoardGrid::MASK_CELLS;
+const unsigned int TaskPool::SPLIT_DEPTH;
+
+/**
+ * Replaces the board with the given dice.
+ */
+void BoardGrid::assign( unsigned int rows,
+                        unsigned int cols,
+                        string** dice ) {
+    wire( rows, cols );
+    releaseFaces();
+    for ( unsigned int i = 0; i < rows; i++ ) {
+        for ( unsigned int j = 0; j < cols; j++ ) {
+            face[ i * cols + j ] = intern( dice[i][j].data(),
+                                           dice[i][j].length() );
+        }
+    }
+    indexFaces();
+}
+
+/**
+ * Replaces the board with dice whose faces are packed one after
+ * another, row by row, each as a length byte followed by its
+ * characters.
+ */
+void BoardGrid::assign( unsigned int rows,
+                        unsigned int cols,
+                        const unsigned char* packed ) {
+    wire( rows, cols );
+    releaseFaces();
+    for ( unsigned int cell = 0; cell < size; cell++ ) {
+        unsigned int n = *packed++;
+        face[cell] = intern( (const char*)packed, n );
+        packed += n;
+    }
+    indexFaces();
+}
+
+/**
+ * Replaces the face of one cell.
+ */
+void BoardGrid::setFace( unsigned int cell, const string& text ) {
+    // the old face keeps its id, though no cell may show it now
+    face[cell] = intern( text.data(), text.length() );
+    indexFaces();
+}
+
+/**
+ * Empties faces, keeping its strings, and their capacity, for the
+ * faces of the next board.
+ */
+void BoardGrid::releaseFaces() {
+    while ( !faces.empty() ) {
+        spare.push_back( std::move( faces.back() ) );
+        faces.pop_back();
+    }
+}
+
+/**
+ * Sets the shape of the board and links the neighbours of its
+ * cells, unless the shape is unchanged.
+ */
+void BoardGrid::wire( unsigned int rows, unsigned int cols ) {
+    if ( rows == this->rows && cols == this->cols
+           && adjStart.size() == size + 1 ) {
+        return;
+    }
+
+    this->rows = rows;
+    this->cols = cols;
+    this->size = rows * cols;
+
+    face.resize( size );
+    adjStart.resize( size + 1 );
+    adj.clear();
+    adjMask.assign( size <= MASK_CELLS ? size : 0, 0 );
+
+    // neighbours in the order setBoard() used to link them
+    for ( int i = 0; i < (int)rows; i++ ) {
+        for ( int j = 0; j < (int)cols; j++ ) {
+            unsigned int cell = i * cols + j;
+            adjStart[cell] = adj.size();
+            for ( int di = -1; di <= 1; di++ ) {
+                for ( int dj = -1; dj <= 1; dj++ ) {
+                    int r = i + di, c = j + dj;
+                    if ( ( di == 0 && dj == 0 ) || r < 0 || c < 0
+                          || r >= (int)rows || c >= (int)cols ) {
+                        continue;
+                    }
+                    adj.push_back( r * cols + c );
+                    if ( size <= MASK_CELLS ) {
+                        adjMask[cell] |= 1ull << ( r * cols + c );
+                    }
+                }
+            }
+        }
+    }
+    adjStart[size] = adj.size();
+}
+
+/**
+ * Indexes the cells by the first character of their face.
+ */
+void BoardGrid::indexFaces() {
+    unsigned int next[256];
+
+    // cells by the first character of their face, in order
+    firstStart.assign( 257, 0 );
+    firstMask.assign( size <= MASK_CELLS ? 256 : 0, 0 );
+    blanks = 0;
+    blankMask = 0;
+    for ( unsigned int cell = 0; cell < size; cell++ ) {
+        if ( !faceAt( cell ).empty() ) {
+            firstStart[ (unsigned char)faceAt( cell )[0] + 1 ]++;
+        }
+        else {
+            blanks++;
+            if ( size <= MASK_CELLS ) blankMask |= 1ull << cell;
+        }
+    }
+    for ( unsigned int c = 0; c < 256; c++ ) {
+        firstStart[c+1] += firstStart[c];
+    }
+    firstCells.resize( firstStart[256] );
+    std::copy( firstStart.begin(), firstStart.end() - 1, next );
+    for ( unsigned int cell = 0; cell < size; cell++ ) {
+        if ( !faceAt( cell ).empty() ) {
+            unsigned int c = (unsigned char)faceAt( cell )[0];
+            firstCells[ next[c]++ ] = cell;
+            if ( size <= MASK_CELLS ) {
+                firstMask[c] |= 1ull << cell;
+            }
+        }
+    }
+}
+
+/**
+ * Returns the id of a face, ignoring case, adding it to faces in
+ * lower case if it is new.
+ */
+unsigned int BoardGrid::intern( const char* text, unsigned int length ) {
+    unsigned int k;
+
+    // boards hold few distinct faces, so a scan beats hashing
+    for ( unsigned int id = 0; id < faces.size(); id++ ) {
+        if ( faces[id].length() != length ) continue;
+        for ( k = 0; k < length; k++ ) {
+            if ( tolower( (unsigned char)text[k] ) != (unsigned char)faces[id][k] ) {
+                break;
+            }
+        }
+        if ( k == length ) return id;
+    }
+
+    // a string kept from an earlier board, lowercased in place
+    if ( !spare.empty() ) {
+        faces.push_back( std::move( spare.back() ) );
+        spare.pop_back();
+    }
+    else {
+        faces.push_back( string() );
+    }
+    faces.back().assign( text, length );
+    for ( k = 0; k < length; k++ ) {
+        faces.back()[k] = tolower( (unsigned char)text[k] );
+    }
+    return faces.size() - 1;
+}
+
+/**
+ * Judges whether the face of a cell matches the word from
+ * position pos on.
+ */
+bool PathFinder::matches( unsigned int cell, unsigned int pos ) const {
+    const string& f = grid.faceAt( cell );
+
+    if ( f.length() > length - pos ) return 0;
+    for ( unsigned int k = 0; k < f.length(); k++ ) {
+        if ( tolower( (unsigned char)word[pos + k] ) != (unsigned char)f[k] ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Extends a path of depth cells by a matching cell, on boards of
+ * at most 64 cells; visited has a bit set for every cell on the
+ * path.
+ *
+ * Returns the number of cells of the first complete path, or 0 if
+ * there is none.
+ */
+unsigned int PathFinder::stepMask( unsigned int cell,
+                                   unsigned int pos,
+                                   unsigned int depth,
+                                   unsigned long long visited ) {
+    unsigned long long next;
+    unsigned int cells;
+
+    path[depth++] = cell;
+    pos += grid.faceAt( cell ).length();
+    if ( pos == length ) return depth;
+
+    // neighbours come in cell order, as they do in adj
+    visited |= 1ull << cell;
+    next = grid.adjMask[cell] & ~visited & ( grid.blankMask
+         | grid.firstMask[ (unsigned char)tolower( (unsigned char)word[pos] ) ] );
+    for ( ; next != 0; next &= next - 1 ) {
+        unsigned int n = __builtin_ctzll( next );
+        if ( matches( n, pos ) ) {
+            cells = stepMask( n, pos, depth, visited );
+            if ( cells != 0 ) return cells;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Extends a path of depth cells by a matching cell, on boards of
+ * any size; the visited cells are the set bits of wide.
+ *
+ * Returns the number of cells of the first complete path, or 0 if
+ * there is none.
+ */
+unsigned int PathFinder::stepWide( unsigned int cell,
+                                   unsigned int pos,
+                                   unsigned int depth ) {
+    unsigned int cells = 0;
+
+    path[depth++] = cell;
+    pos += grid.faceAt( cell ).length();
+    if ( pos == length ) return depth;
+
+    wide[cell / 64] |= 1ull << ( cell % 64 );
+    for ( unsigned int k = grid.adjStart[cell];
+                       k < grid.adjStart[cell+1] && cells == 0; k++ ) {
+        unsigned int n = grid.adj[k];
+        if ( !( wide[n / 64] >> ( n % 64 ) & 1 ) && matches( n, pos ) ) {
+            cells = stepWide( n, pos, depth );
+        }
+    }
+    wide[cell / 64] &= ~( 1ull << ( cell % 64 ) );
+    return cells;
+}
+
+/**
+ * Finds a path spelling the specified characters.
+ *
+ * Writes the cells of the path to path, which must have room for
+ * one per cell of the board, and returns how many there are, or 0
+ * if the word is not on the board.
+ */
+unsigned int PathFinder::find( const char* word,
+                               unsigned int length,
+                               unsigned int* path ) {
+    unsigned int c, n, cells = 0;
+    unsigned int words = ( grid.size + 63 ) / 64;
+
+    if ( length == 0 || grid.size == 0 ) return 0;
+
+    this->word = word;
+    this->length = length;
+    this->path = path;
+
+    // grows with the board; every search leaves it clear
+    if ( grid.size > BoardGrid::MASK_CELLS && wide.size() < words ) {
+        wide.resize( words, 0 );
+    }
+
+    // a path may start on a blank face, which the index leaves out
+    c = (unsigned char)tolower( (unsigned char)word[0] );
+    n = grid.blanks != 0 ? grid.size
+                         : grid.firstStart[c+1] - grid.firstStart[c];
+    for ( unsigned int k = 0; k < n && cells == 0; k++ ) {
+        unsigned int cell = grid.blanks != 0 ? k
+                          : grid.firstCells[ grid.firstStart[c] + k ];
+        if ( !matches( cell, 0 ) ) continue;
+        if ( grid.size <= BoardGrid::MASK_CELLS ) {
+            cells = stepMask( cell, 0, 0, 0 );
+        }
+        else {
+            cells = stepWide( cell, 0, 0 );
+        }
+    }
+    return cells;
+}
+
+/**
+ * Returns the child of a trie node labelled c, adding it if add
+ * is set; returns 0 if there is none.
+ */
+unsigned int PathFinder::child( unsigned int node, char c, bool add ) {
+    unsigned int mask = edges.size() - 1;
+    unsigned int h = ( node * 257 + (unsigned char)c ) * 2654435761u;
+    unsigned int slot = ( h ^ ( h >> 16 ) ) & mask;
+
+    while ( edges[slot] != 0 ) {
+        const QueryNode& n = trie[ edges[slot] ];
+        if ( n.parent == node && n.label == c ) return edges[slot];
+        slot = ( slot + 1 ) & mask;
+    }
+    if ( !add ) return 0;
+
+    QueryNode n = { c, 0, 0, node, 0, 0, 0 };
+    trie.push_back( n );
+    edges[slot] = trie.size() - 1;
+    return trie.size() - 1;
+}
+
+/**
+ * Follows the face of a cell down from a trie node.
+ *
+ * Returns false if the trie has no such path.
+ */
+bool PathFinder::descend( unsigned int& node, unsigned int cell ) {
+    const string& f = grid.faceAt( cell );
+
+    for ( unsigned int k = 0; k < f.length(); k++ ) {
+        node = child( node, f[k], 0 );
+        if ( node == 0 ) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Records the current path of depth cells as the path of the word
+ * ending at a trie node.
+ */
+void PathFinder::resolve( unsigned int node, unsigned int depth ) {
+    trie[node].found = 1;
+    trie[node].start = found.size();
+    trie[node].cells = depth;
+    found.insert( found.end(), trail.begin(), trail.begin() + depth );
+
+    // the node and every ancestor have one word less to look for
+    for ( ; ; node = trie[node].parent ) {
+        trie[node].open--;
+        if ( node == 0 ) break;
+    }
+}
+
+/**
+ * Extends the current path by a cell, for every word below a trie
+ * node at once; the visited cells are the set bits of wide.
+ */
+void PathFinder::searchMany( unsigned int cell,
+                             unsigned int node,
+                             unsigned int depth ) {
+    if ( !descend( node, cell ) || trie[node].open == 0 ) return;
+
+    trail[depth++] = cell;
+    if ( trie[node].end && !trie[node].found ) {
+        resolve( node, depth );
+    }
+
+    wide[cell / 64] |= 1ull << ( cell % 64 );
+    for ( unsigned int k = grid.adjStart[cell];
+          k < grid.adjStart[cell+1] && trie[node].open != 0; k++ ) {
+        unsigned int n = grid.adj[k];
+        if ( !( wide[n / 64] >> ( n % 64 ) & 1 ) ) {
+            searchMany( n, node, depth );
+        }
+    }
+    wide[cell / 64] &= ~( 1ull << ( cell % 64 ) );
+}
+
+/**
+ * Finds a path spelling each of the specified words.
+ *
+ * Sets paths[i] to the path find() gives for words[i], or to an
+ * empty vector if it is not on the board. The trie is searched in
+ * the order find() searches, so the first path reaching a word is
+ * the one find() returns.
+ */
+void PathFinder::findMany( const string* words, unsigned int count,
+                           vector< vector<int> >& paths ) {
+    unsigned int words64 = ( grid.size + 63 ) / 64;
+    unsigned int slots = 16, chars = 0, cells;
+
+    paths.resize( count );
+    trail.resize( grid.size );
+
+    // guided by the first-letter masks, single searches on a small
+    // board cost less than building the trie
+    if ( grid.size <= BoardGrid::MASK_CELLS ) {
+        for ( unsigned int i = 0; i < count; i++ ) {
+            cells = find( words[i].data(), words[i].length(), trail.data() );
+            paths[i].assign( trail.begin(), trail.begin() + cells );
+        }
+        return;
+    }
+
+    QueryNode root = { 0, 0, 0, 0, 0, 0, 0 };
+    trie.assign( 1, root );
+    nodes.assign( count, 0 );
+    found.clear();
+
+    // one edge per character at most, kept at most half full
+    for ( unsigned int i = 0; i < count; i++ ) {
+        chars += words[i].length();
+    }
+    while ( slots < chars * 2 ) {
+        slots *= 2;
+    }
+    edges.assign( slots, 0 );
+
+    for ( unsigned int i = 0; i < count; i++ ) {
+        unsigned int node = 0, c;
+
+        // words which no face starts, and the empty word, are left
+        // out of the trie, so they stay at the root and unfound
+        if ( words[i].empty() ) continue;
+        c = (unsigned char)tolower( (unsigned char)words[i][0] );
+        if ( grid.firstStart[c] == grid.firstStart[c+1] ) continue;
+
+        for ( unsigned int k = 0; k < words[i].length(); k++ ) {
+            node = child( node, tolower( (unsigned char)words[i][k] ), 1 );
+        }
+        nodes[i] = node;
+
+        // a word looked for twice is counted once
+        if ( !trie[node].end ) {
+            trie[node].end = 1;
+            for ( ; ; node = trie[node].parent ) {
+                trie[node].open++;
+                if ( node == 0 ) break;
+            }
+        }
+    }
+
+    if ( wide.size() < words64 ) {
+        wide.resize( words64, 0 );
+    }
+    for ( unsigned int cell = 0; cell < grid.size && trie[0].open != 0;
+                                                             cell++ ) {
+        searchMany( cell, 0, 0 );
+    }
+
+    for ( unsigned int i = 0; i < count; i++ ) {
+        const QueryNode& n = trie[ nodes[i] ];
+        paths[i].assign( found.begin() + n.start,
+                         found.begin() + n.start + n.cells );
+    }
+}
+
+// hash table slots a new WordSet starts with; a power of two
+static const unsigned int WORDSET_SLOTS = 256;
+
+/**
+ * Hashes a word, FNV-1a.
+ */
+static unsigned int hashWord( const char* data, unsigned int length ) {
+    unsigned int h = 2166136261u;
+    for ( unsigned int i = 0; i < length; i++ ) {
+        h = ( h ^ (unsigned char)data[i] ) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Constructs an empty WordSet.
+ */
+WordSet::WordSet() : count(0) {
+    starts.push_back( 0 );
+    table.assign( WORDSET_SLOTS, 0 );
+}
+
+/**
+ * Removes every word, keeping the capacity.
+ */
+void WordSet::clear() {
+    if ( count == 0 ) return;
+    text.clear();
+    starts.resize( 1 );
+    std::fill( table.begin(), table.end(), 0 );
+    count = 0;
+}
+
+/**
+ * Exchanges words with another WordSet.
+ */
+void WordSet::swap( WordSet& other ) {
+    text.swap( other.text );
+    starts.swap( other.starts );
+    table.swap( other.table );
+    std::swap( count, other.count );
+}
+
+/**
+ * Doubles the hash table and rehashes the words.
+ */
+void WordSet::grow() {
+    unsigned int mask = table.size() * 2 - 1;
+
+    table.assign( table.size() * 2, 0 );
+    for ( unsigned int w = 0; w < count; w++ ) {
+        unsigned int slot = hashWord( &text[ starts[w] ],
+                                      starts[w+1] - starts[w] ) & mask;
+        while ( table[slot] != 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        table[slot] = w + 1;
+    }
+}
+
+/**
+ * Returns the hash table slot holding a word, or the empty slot
+ * where it would go.
+ */
+unsigned int WordSet::slot( const char* data, unsigned int length ) const {
+    unsigned int mask = table.size() - 1;
+    unsigned int slot = hashWord( data, length ) & mask;
+
+    // slots hold word numbers plus one, so 0 is empty
+    while ( table[slot] != 0 ) {
+        unsigned int w = table[slot] - 1;
+        if ( starts[w+1] - starts[w] == length
+              && !memcmp( &text[ starts[w] ], data, length ) ) {
+            break;
+        }
+        slot = ( slot + 1 ) & mask;
+    }
+    return slot;
+}
+
+/**
+ * Adds a word.
+ *
+ * Returns true if the word was not in the set.
+ */
+bool WordSet::insert( const char* data, unsigned int length ) {
+    unsigned int s = slot( data, length );
+
+    if ( table[s] != 0 ) return 0;
+
+    text.insert( text.end(), data, data + length );
+    starts.push_back( text.size() );
+    table[s] = ++count;
+
+    // kept at most half full
+    if ( count * 2 > table.size() ) {
+        grow();
+    }
+    return 1;
+}
+
+/**
+ * Returns the number of a word, counting from 0 in the order they
+ * were added, or -1 if it is not in the set.
+ */
+int WordSet::find( const char* data, unsigned int length ) const {
+    return (int)table[ slot( data, length ) ] - 1;
+}
+
+/**
+ * Removes every word and path, keeping the capacity.
+ */
+void WordPaths::clear() {
+    words.clear();
+    cells.clear();
+    starts.resize( 1 );
+}
+
+/**
+ * Returns the number of a word, or -1 if it was not found.
+ */
+int WordPaths::find( const string& word ) const {
+    return words.find( word.data(), word.length() );
+}
+
+/**
+ * Returns the path of a word as isOnBoard() does, or an empty
+ * vector if it was not found.
+ */
+vector<int> WordPaths::getPath( const string& word ) const {
+    int w = find( word );
+
+    if ( w < 0 ) return vector<int>();
+    return vector<int>( path( w ), path( w ) + pathLength( w ) );
+}
+
+/**
+ * Takes a word and its path from a search.
+ */
+void WordPaths::word( const char* data, unsigned int length,
+                      const unsigned int* path, unsigned int cells ) {
+    // a search passes each word once, but several may share a sink
+    if ( words.insert( data, length ) ) {
+        this->cells.insert( this->cells.end(), path, path + cells );
+        starts.push_back( this->cells.size() );
+    }
+}
+
+/**
+ * Passes words from several threads to one WordSink, each once.
+ */
+class SharedSink : public WordSink {
+
+private:
+    WordSink* sink;
+    WordSet found;
+    std::mutex lock;
+
+public:
+    SharedSink( WordSink* sink ) : sink(sink) {}
+
+    void word( const char* data, unsigned int length,
+               const unsigned int* path, unsigned int cells ) {
+        std::lock_guard<std::mutex> guard( lock );
+        if ( found.insert( data, length ) ) {
+            sink->word( data, length, path, cells );
+        }
+    }
+
+};
+
+/**
+ * Constructs a TaskPool for the given number of threads.
+ */
+TaskPool::TaskPool( unsigned int threads )
+    : threads(threads), queues(new Queue[threads]),
+      queued(0), pending(0), hungry(0), steals(0), total(0) {}
+
+/**
+ * Queues a task on behalf of a thread, taking its contents.
+ */
+void TaskPool::push( unsigned int thread, SearchTask& task ) {
+    {
+        std::lock_guard<std::mutex> lock( queues[thread].lock );
+        pending++;
+        total++;
+        queues[thread].tasks.push_back( std::move( task ) );
+        queued++;
+    }
+
+    // a thread counts itself hungry before it last looks at queued
+    if ( hungry.load() > 0 ) {
+        std::lock_guard<std::mutex> lock( idle );
+        wake.notify_one();
+    }
+}
+
+/**
+ * Takes a task for a thread, stealing one if its own queue is
+ * empty, and sleeping while other threads may still split some.
+ *
+ * Returns false once every task has been searched.
+ */
+bool TaskPool::take( unsigned int thread, SearchTask& task ) {
+    bool waiting = 0, found = 0;
+
+    while ( !found ) {
+        {
+            // own queue, newest first: the smallest subtrees
+            Queue& q = queues[thread];
+            std::lock_guard<std::mutex> lock( q.lock );
+            if ( !q.tasks.empty() ) {
+                task = std::move( q.tasks.back() );
+                q.tasks.pop_back();
+                queued--;
+                found = 1;
+            }
+        }
+
+        // the others, oldest first: the largest subtrees
+        for ( unsigned int k = 1; !found && k < threads; k++ ) {
+            Queue& q = queues[ ( thread + k ) % threads ];
+            std::lock_guard<std::mutex> lock( q.lock );
+            if ( !q.tasks.empty() ) {
+                task = std::move( q.tasks.front() );
+                q.tasks.pop_front();
+                queued--;
+                steals++;
+                found = 1;
+            }
+        }
+
+        if ( found ) break;
+
+        // nothing queued, and nothing running which could split
+        if ( pending.load() == 0 ) break;
+
+        if ( !waiting ) {
+            waiting = 1;
+            hungry++;
+        }
+
+        // push() and done() notify under the lock after changing
+        // the counts, so neither can slip between the check and the
+        // wait
+        std::unique_lock<std::mutex> lock( idle );
+        while ( queued.load() == 0 && pending.load() != 0 ) {
+            wake.wait( lock );
+        }
+    }
+
+    if ( waiting ) {
+        hungry--;
+    }
+    return found;
+}
+
+/**
+ * Marks a task taken with take() as searched.
+ */
+void TaskPool::done() {
+    if ( --pending == 0 ) {
+        std::lock_guard<std::mutex> lock( idle );
+        wake.notify_all();
+    }
+}
+
+/**
+ * Constructs a GridSearch which passes the words of at least
+ * min letters to sink, each once.
+ */
+template<class L>
+GridSearch<L>::GridSearch( const BoardGrid& grid, const L& lex,
+                           unsigned int min, WordSink* sink )
+    : grid(grid), lex(lex), min(min), sink(sink), depth(0),
+      pool(nullptr), thread(0), split(0) {
+    path.reserve( grid.size );
+    if ( grid.size > BoardGrid::MASK_CELLS ) {
+        wide.assign( ( grid.size + 63 ) / 64, 0 );
+    }
+}
+
+/**
+ * Lets the search split subtrees of paths of at most split
+ * dice into pool, on behalf of a thread, while another thread
+ * is waiting for work.
+ */
+template<class L>
+void GridSearch<L>::share( TaskPool* pool, unsigned int thread,
+                                           unsigned int split ) {
+    this->pool = pool;
+    this->thread = thread;
+    this->split = split;
+}
+
+/**
+ * Finds all the words in the subtree of a task.
+ */
+template<class L>
+void GridSearch<L>::search( SearchTask& task ) {
+    str = task.prefix;
+    path.assign( task.path.begin(), task.path.end() );
+
+    if ( grid.size <= BoardGrid::MASK_CELLS ) {
+        searchMask( task.cell, task.cursor, task.visited );
+    }
+    else {
+        wide.swap( task.wide );
+        depth = 0;
+        for ( unsigned int k = 0; k < wide.size(); k++ ) {
+            depth += __builtin_popcountll( wide[k] );
+        }
+        searchWide( task.cell, task.cursor );
+    }
+}
+
+/**
+ * Queues the subtree through a cell next to the current path
+ * as a task.
+ */
+template<class L>
+void GridSearch<L>::spawn( unsigned int cell,
+                           const LexiconCursor& cursor,
+                           unsigned long long visited ) {
+    SearchTask task;
+
+    task.cell = cell;
+    task.cursor = cursor;
+    task.visited = visited;
+    task.prefix = str;
+    task.path = path;
+    if ( grid.size > BoardGrid::MASK_CELLS ) {
+        task.wide = wide;
+    }
+    pool->push( thread, task );
+}
+
+/**
+ * Forgets the words found so far and fits the scratch to the
+ * board, which may have been reassigned since the search was
+ * constructed.
+ */
+template<class L>
+void GridSearch<L>::reset() {
+    found.clear();
+    path.reserve( grid.size );
+    if ( grid.size > BoardGrid::MASK_CELLS ) {
+        wide.assign( ( grid.size + 63 ) / 64, 0 );
+    }
+}
+
+/**
+ * Sets the minimum length of the words the next searches pass on,
+ * and the sink they pass them to.
+ */
+template<class L>
+void GridSearch<L>::bind( unsigned int min, WordSink* sink ) {
+    this->min = min;
+    this->sink = sink;
+}
+
+/**
+ * Finds all the words on paths starting at a cell.
+ */
+template<class L>
+void GridSearch<L>::searchFrom( unsigned int cell ) {
+    if ( grid.size <= BoardGrid::MASK_CELLS ) {
+        searchMask( cell, LexiconCursor(), 0 );
+    }
+    else {
+        searchWide( cell, LexiconCursor() );
+    }
+}
+
+/**
+ * Extends the current path by a cell, on boards of at most
+ * 64 cells; visited has a bit set for every cell on the path.
+ */
+template<class L>
+void GridSearch<L>::searchMask( unsigned int cell,
+                                LexiconCursor cursor,
+                                unsigned long long visited ) {
+    const string& f = grid.faceAt( cell );
+    unsigned long long next;
+
+    if ( !lex.advance( cursor, f.data(), f.length() ) ) {
+        return;
+    }
+
+    str.append( f );
+    path.push_back( cell );
+
+    if ( cursor.end && str.length() >= min
+           && found.insert( str.data(), str.length() ) ) {
+        sink->word( str.data(), str.length(), path.data(), path.size() );
+    }
+
+    visited |= 1ull << cell;
+    for ( next = grid.adjMask[cell] & ~visited; next != 0;
+                                           next &= next - 1 ) {
+        if ( pool != nullptr && pool->wantsWork()
+               && (unsigned int)__builtin_popcountll( visited ) <= split ) {
+            spawn( __builtin_ctzll( next ), cursor, visited );
+        }
+        else {
+            searchMask( __builtin_ctzll( next ), cursor, visited );
+        }
+    }
+
+    path.pop_back();
+    str.resize( str.length() - f.length() );
+}
+
+/**
+ * Extends the current path by a cell, on boards of any size;
+ * the visited cells are the set bits of wide.
+ */
+template<class L>
+void GridSearch<L>::searchWide( unsigned int cell,
+                                LexiconCursor cursor ) {
+    const string& f = grid.faceAt( cell );
+
+    if ( !lex.advance( cursor, f.data(), f.length() ) ) {
+        return;
+    }
+
+    str.append( f );
+    path.push_back( cell );
+
+    if ( cursor.end && str.length() >= min
+           && found.insert( str.data(), str.length() ) ) {
+        sink->word( str.data(), str.length(), path.data(), path.size() );
+    }
+
+    wide[cell / 64] |= 1ull << ( cell % 64 );
+    depth++;
+    for ( unsigned int k = grid.adjStart[cell];
+                       k < grid.adjStart[cell+1]; k++ ) {
+        unsigned int n = grid.adj[k];
+        if ( wide[n / 64] >> ( n % 64 ) & 1 ) {
+            continue;
+        }
+        if ( pool != nullptr && pool->wantsWork() && depth <= split ) {
+            spawn( n, cursor, 0 );
+        }
+        else {
+            searchWide( n, cursor );
+        }
+    }
+    depth--;
+    wide[cell / 64] &= ~( 1ull << ( cell % 64 ) );
+
+    path.pop_back();
+    str.resize( str.length() - f.length() );
+}
+
+/**
+ * Constructs a FixedSearch of a board of R rows and C columns
+ * which passes the words of at least min letters to sink, each
+ * once.
+ */
+template<class L, unsigned int R, unsigned int C>
+FixedSearch<L, R, C>::FixedSearch( const BoardGrid& grid, const L& lex,
+                                   unsigned int min, WordSink* sink )
+    : grid(grid), lex(lex), min(min), sink(sink) {}
+
+/**
+ * Sets the minimum length of the words the next searches pass on,
+ * and the sink they pass them to.
+ */
+template<class L, unsigned int R, unsigned int C>
+void FixedSearch<L, R, C>::bind( unsigned int min, WordSink* sink ) {
+    this->min = min;
+    this->sink = sink;
+}
+
+/**
+ * Finds all the words on the board, as it is now; a board
+ * reassigned since the last search is searched afresh.
+ */
+template<class L, unsigned int R, unsigned int C>
+void FixedSearch<L, R, C>::search() {
+    unsigned int letters = 0;
+
+    found.clear();
+    for ( unsigned int cell = 0; cell < R * C; cell++ ) {
+        faceData[cell] = grid.faceAt( cell ).data();
+        faceLength[cell] = grid.faceAt( cell ).length();
+        letters += faceLength[cell];
+    }
+
+    // a path spells at most every face once
+    if ( text.size() < letters + 1 ) {
+        text.resize( letters + 1 );
+    }
+
+    for ( unsigned int cell = 0; cell < R * C; cell++ ) {
+        extend( cell, LexiconCursor(), 0, 0, 0 );
+    }
+}
+
+/**
+ * Extends a path of depth cells spelling length characters by a
+ * cell; visited has a bit set for every cell on the path.
+ */
+template<class L, unsigned int R, unsigned int C>
+void FixedSearch<L, R, C>::extend( unsigned int cell,
+                                   LexiconCursor cursor,
+                                   unsigned int visited,
+                                   unsigned int depth,
+                                   unsigned int length ) {
+    unsigned int next;
+
+    if ( !lex.advance( cursor, faceData[cell], faceLength[cell] ) ) {
+        return;
+    }
+
+    memcpy( &text[length], faceData[cell], faceLength[cell] );
+    length += faceLength[cell];
+    path[depth++] = cell;
+
+    if ( cursor.end && length >= min && found.insert( &text[0], length ) ) {
+        sink->word( &text[0], length, path, depth );
+    }
+
+    visited |= 1u << cell;
+    for ( next = Shape::adj[cell] & ~visited; next != 0; next &= next - 1 ) {
+        extend( __builtin_ctz( next ), cursor, visited, depth, length );
+    }
+}
+
+/**
+ * Constructs a SearchSet for a board and a lexicon, which must
+ * outlive it, passing the words of at least min letters to sink.
+ */
+template<class L>
+SearchSet<L>::SearchSet( const BoardGrid& grid, const L& lex,
+                         unsigned int min, WordSink* sink )
+    : grid(grid), walk( grid, lex, min, sink ),
+      small( grid, lex, min, sink ), medium( grid, lex, min, sink ) {}
+
+/**
+ * Sets the minimum length of the words the next searches pass on,
+ * and the sink they pass them to.
+ */
+template<class L>
+void SearchSet<L>::bind( unsigned int min, WordSink* sink ) {
+    walk.bind( min, sink );
+    small.bind( min, sink );
+    medium.bind( min, sink );
+}
+
+/**
+ * Finds all the words on the board, as it is now, with the search
+ * for its shape.
+ */
+template<class L>
+void SearchSet<L>::search() {
+    // the shapes with a FixedSearch of their own
+    if ( grid.rows == 4 && grid.cols == 4 ) {
+        small.search();
+    }
+    else if ( grid.rows == 5 && grid.cols == 5 ) {
+        medium.search();
+    }
+    else {
+        walk.reset();
+        for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+            walk.searchFrom( cell );
+        }
+    }
+}
+
+/**
+ * Returns the CPU time the calling thread has used, in seconds.
+ */
+static double threadSeconds() {
+    struct timespec ts;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Finds all the words of at least min letters on a board which a
+ * lexicon contains, and passes each to sink once, as soon as it is
+ * found.
+ *
+ * With more than one thread, every start cell is queued in a
+ * TaskPool and subtrees of paths of at most split dice may be
+ * split off as well; the threads pass their words through one
+ * SharedSink.
+ */
+template<class L>
+void searchGrid( const BoardGrid& grid, const L& lex, unsigned int min,
+                 WordSink* sink, unsigned int threads,
+                 unsigned int split, SearchStats* stats ) {
+    typedef std::chrono::steady_clock Clock;
+    SharedSink shared( sink );
+    vector<double> busy, finished;
+    vector<std::thread> pool;
+    Clock::time_point start = Clock::now();
+
+    if ( threads > grid.size ) {
+        threads = grid.size;
+    }
+    if ( threads == 0 ) return;
+
+    if ( threads == 1 && stats == nullptr ) {
+        GridSearch<L> search( grid, lex, min, sink );
+        for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+            search.searchFrom( cell );
+        }
+        return;
+    }
+
+    TaskPool tasks( threads );
+    for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+        SearchTask task;
+        task.cell = cell;
+        task.visited = 0;
+        if ( grid.size > BoardGrid::MASK_CELLS ) {
+            task.wide.assign( ( grid.size + 63 ) / 64, 0 );
+        }
+        tasks.push( cell % threads, task );
+    }
+
+    busy.assign( threads, 0 );
+    finished.assign( threads, 0 );
+    auto work = [&]( unsigned int t ) {
+        GridSearch<L> search( grid, lex, min, &shared );
+        SearchTask task;
+        search.share( &tasks, t, split );
+        while ( tasks.take( t, task ) ) {
+            double begin = threadSeconds();
+            search.search( task );
+            busy[t] += threadSeconds() - begin;
+            tasks.done();
+        }
+        finished[t] = std::chrono::duration<double>( Clock::now() - start ).count();
+    };
+
+    for ( unsigned int t = 1; t < threads; t++ ) {
+        pool.push_back( std::thread( work, t ) );
+    }
+    work( 0 );
+    for ( unsigned int t = 0; t < pool.size(); t++ ) {
+        pool[t].join();
+    }
+
+    if ( stats != nullptr ) {
+        stats->seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+        stats->busy = busy;
+        stats->finished = finished;
+        stats->tasks = tasks.tasks();
+        stats->steals = tasks.stolen();
+    }
+}
+
+template class GridSearch<TST>;
+template class GridSearch<DAWG>;
+template class FixedSearch<TST, 4, 4>;
+template class FixedSearch<TST, 5, 5>;
+template class FixedSearch<DAWG, 4, 4>;
+template class FixedSearch<DAWG, 5, 5>;
+template class SearchSet<TST>;
+template class SearchSet<DAWG>;
+
+template void searchGrid<TST>( const BoardGrid&, const TST&, unsigned int,
+                               WordSink*, unsigned int, unsigned int,
+                               SearchStats* );
+template void searchGrid<DAWG>( const BoardGrid&, const DAWG&, unsigned int,
+                                WordSink*, unsigned int, unsigned int,
+                                SearchStats* );
@@ -0,0 +1,804 @@
+#ifndef BOGGLEGRID_H
+#define BOGGLEGRID_H
+
+#include <vector>
+#include <string>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#include "boggleutil.h"
+
+using std::vector;
+using std::string;
+using std::set;
+
+/**
+ * Represents a board as flat arrays indexed by cell.
+ *
+ * Cells are numbered row by row, as isOnBoard() reports them.
+ * Each distinct face is stored once, lowercased, in faces, and
+ * face holds the id of every cell's face. The neighbours of cell
+ * i are adj[adjStart[i]] up to adj[adjStart[i+1]]; on boards of
+ * at most 64 cells they are also kept as one bit mask per cell,
+ * so a search can take its visited set as a single word.
+ *
+ * The cells whose face starts with character c are, in order,
+ * firstCells[firstStart[c]] up to firstCells[firstStart[c+1]],
+ * and on boards of at most 64 cells the set bits of firstMask[c].
+ * blanks counts the cells with a blank face, which spells nothing
+ * but may still be passed through; on boards of at most 64 cells
+ * they are the set bits of blankMask. A board assigned over one of
+ * the same shape keeps its neighbours and reuses every array, and
+ * the strings of the faces of earlier boards are kept for those of
+ * later ones, so assigning boards allocates nothing once the arrays
+ * and strings have grown to fit them.
+ */
+class BoardGrid {
+
+private:
+    vector<string> spare;
+
+    /**
+     * Sets the shape of the board and links the neighbours of its
+     * cells, unless the shape is unchanged.
+     */
+    void wire(unsigned int rows, unsigned int cols);
+
+    /**
+     * Indexes the cells by the first character of their face.
+     */
+    void indexFaces();
+
+    /**
+     * Empties faces, keeping its strings, and their capacity, for
+     * the faces of the next board.
+     */
+    void releaseFaces();
+
+public:
+    static const unsigned int MASK_CELLS = 64;
+
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int size;
+    vector<string> faces;
+    vector<unsigned int> face;
+    vector<unsigned int> adjStart;
+    vector<unsigned int> adj;
+    vector<unsigned long long> adjMask;
+    vector<unsigned int> firstStart;
+    vector<unsigned int> firstCells;
+    vector<unsigned long long> firstMask;
+    unsigned int blanks;
+    unsigned long long blankMask;
+
+    /**
+     * Constructs an empty BoardGrid.
+     */
+    BoardGrid() : rows(0), cols(0), size(0), blanks(0), blankMask(0) {}
+
+    /**
+     * Replaces the board with the given dice.
+     */
+    void assign(unsigned int rows, unsigned int cols, string** dice);
+
+    /**
+     * Replaces the board with dice whose faces are packed one after
+     * another, row by row, each as a length byte followed by its
+     * characters.
+     */
+    void assign(unsigned int rows, unsigned int cols,
+                const unsigned char* packed);
+
+    /**
+     * Replaces the face of one cell.
+     */
+    void setFace(unsigned int cell, const string& text);
+
+    /**
+     * Returns the id of a face, ignoring case, adding it to faces
+     * in lower case if it is new.
+     */
+    unsigned int intern(const char* text, unsigned int length);
+
+    /**
+     * Returns the letters on the face of a cell.
+     */
+    const string& faceAt(unsigned int cell) const {
+        return faces[ face[cell] ];
+    }
+
+};
+
+/**
+ * Finds a path spelling a word on a BoardGrid, ignoring case.
+ *
+ * Start cells are tried in order and paths extended through the
+ * neighbours of their last cell in order, so the path found is the
+ * first of all paths spelling the word, as a board search meets it.
+ * Only cells whose face starts with the next character of the word
+ * are tried, taken from the board's first-character index, along
+ * with any blank cells; on boards of at most 64 cells they are
+ * masked with the neighbours and the unvisited cells in one step.
+ * Once the scratch has grown to the board, a query allocates
+ * nothing.
+ */
+class PathFinder {
+
+private:
+    /**
+     * A node of the trie of words findMany() looks for.
+     *
+     * Children are found through the hash table edges, keyed by
+     * parent and label; 0 marks an empty slot, since the root is
+     * never anyone's child. open counts the words at or below the
+     * node which have no path yet; once it is 0 the search stops
+     * following the node.
+     */
+    struct QueryNode {
+        char label;
+        bool end;
+        bool found;
+        unsigned int parent;
+        unsigned int open;
+        unsigned int start;
+        unsigned int cells;
+    };
+
+    const BoardGrid& grid;
+    vector<unsigned long long> wide;
+    const char* word;
+    unsigned int length;
+    unsigned int* path;
+    vector<QueryNode> trie;
+    vector<unsigned int> edges;
+    vector<unsigned int> nodes;
+    vector<unsigned int> trail;
+    vector<unsigned int> found;
+
+    /**
+     * Returns the child of a trie node labelled c, adding it if
+     * add is set; returns 0 if there is none.
+     */
+    unsigned int child(unsigned int node, char c, bool add);
+
+    /**
+     * Follows the face of a cell down from a trie node.
+     *
+     * Returns false if the trie has no such path.
+     */
+    bool descend(unsigned int& node, unsigned int cell);
+
+    /**
+     * Records the current path of depth cells as the path of the
+     * word ending at a trie node.
+     */
+    void resolve(unsigned int node, unsigned int depth);
+
+    /**
+     * Extends the current path by a cell, for every word below a
+     * trie node at once; the visited cells are the set bits of
+     * wide.
+     */
+    void searchMany(unsigned int cell, unsigned int node,
+                    unsigned int depth);
+
+    /**
+     * Judges whether the face of a cell matches the word from
+     * position pos on.
+     */
+    bool matches(unsigned int cell, unsigned int pos) const;
+
+    /**
+     * Extends a path of depth cells by a matching cell, on boards
+     * of at most 64 cells; visited has a bit set for every cell on
+     * the path.
+     *
+     * Returns the number of cells of the first complete path, or 0
+     * if there is none.
+     */
+    unsigned int stepMask(unsigned int cell, unsigned int pos,
+                          unsigned int depth, unsigned long long visited);
+
+    /**
+     * Extends a path of depth cells by a matching cell, on boards
+     * of any size; the visited cells are the set bits of wide.
+     *
+     * Returns the number of cells of the first complete path, or 0
+     * if there is none.
+     */
+    unsigned int stepWide(unsigned int cell, unsigned int pos,
+                          unsigned int depth);
+
+public:
+    /**
+     * Constructs a PathFinder for a board, which must outlive it.
+     */
+    PathFinder(const BoardGrid& grid)
+        : grid(grid), word(nullptr), length(0), path(nullptr) {}
+
+    /**
+     * Finds a path spelling the specified characters.
+     *
+     * Writes the cells of the path to path, which must have room
+     * for one per cell of the board, and returns how many there
+     * are, or 0 if the word is not on the board.
+     */
+    unsigned int find(const char* word, unsigned int length,
+                      unsigned int* path);
+
+    /**
+     * Finds a path spelling each of the specified words.
+     *
+     * Sets paths[i] to the path find() gives for words[i], or to
+     * an empty vector if it is not on the board. On boards of more
+     * than 64 cells the words are put in a trie and the board
+     * searched once for all of them, so words sharing a prefix
+     * share the paths spelling it, and a branch is dropped once
+     * every word below it has a path. Smaller boards are searched
+     * once per word, which the first-letter masks keep cheaper
+     * than building the trie.
+     */
+    void findMany(const string* words, unsigned int count,
+                  vector< vector<int> >& paths);
+
+};
+
+/**
+ * Receives the words a board search finds, as it finds them.
+ */
+class WordSink {
+
+public:
+    /**
+     * Takes a word, the first time the search finds it, and the
+     * cells of the path it was found along, in order.
+     *
+     * The characters and cells are only valid during the call.
+     */
+    virtual void word(const char* data, unsigned int length,
+                      const unsigned int* path, unsigned int cells) = 0;
+
+    virtual ~WordSink() {}
+
+};
+
+/**
+ * Represents a set of words in one buffer, for telling words
+ * already found from new ones.
+ *
+ * Words are copied into text, one after another, and found
+ * through an open-addressing hash table of their numbers. clear()
+ * keeps the capacity, so a WordSet reused across searches stops
+ * allocating once it has grown to fit them.
+ */
+class WordSet {
+
+private:
+    vector<char> text;
+    vector<unsigned int> starts;
+    vector<unsigned int> table;
+    unsigned int count;
+
+    /**
+     * Doubles the hash table and rehashes the words.
+     */
+    void grow();
+
+    /**
+     * Returns the hash table slot holding a word, or the empty
+     * slot where it would go.
+     */
+    unsigned int slot(const char* data, unsigned int length) const;
+
+public:
+    /**
+     * Constructs an empty WordSet.
+     */
+    WordSet();
+
+    /**
+     * Removes every word, keeping the capacity.
+     */
+    void clear();
+
+    /**
+     * Exchanges words with another WordSet.
+     */
+    void swap(WordSet& other);
+
+    /**
+     * Adds a word.
+     *
+     * Returns true if the word was not in the set.
+     */
+    bool insert(const char* data, unsigned int length);
+
+    /**
+     * Returns the number of a word, counting from 0 in the order
+     * they were added, or -1 if it is not in the set.
+     */
+    int find(const char* data, unsigned int length) const;
+
+    /**
+     * Returns the number of words.
+     */
+    unsigned int size() const { return count; }
+
+    /**
+     * Returns the characters of a word, by number.
+     */
+    const char* data(unsigned int w) const { return &text[ starts[w] ]; }
+
+    /**
+     * Returns the length of a word, by number.
+     */
+    unsigned int length(unsigned int w) const {
+        return starts[w+1] - starts[w];
+    }
+
+};
+
+/**
+ * Represents the words of a board search with the path each was
+ * first found along, in flat buffers.
+ *
+ * Passed to a search as its sink, it numbers the words in the
+ * order they arrive and keeps all of their paths in one array of
+ * cells, so recording them costs a copy of the path per word and
+ * no allocation once the buffers have grown. clear() keeps them.
+ */
+class WordPaths : public WordSink {
+
+private:
+    WordSet words;
+    vector<unsigned int> cells;
+    vector<unsigned int> starts;
+
+public:
+    /**
+     * Constructs an empty WordPaths.
+     */
+    WordPaths() { starts.push_back( 0 ); }
+
+    /**
+     * Removes every word and path, keeping the capacity.
+     */
+    void clear();
+
+    /**
+     * Returns the number of words.
+     */
+    unsigned int size() const { return words.size(); }
+
+    /**
+     * Returns the characters of a word, by number.
+     */
+    const char* wordData(unsigned int w) const { return words.data( w ); }
+
+    /**
+     * Returns the length of a word, by number.
+     */
+    unsigned int wordLength(unsigned int w) const {
+        return words.length( w );
+    }
+
+    /**
+     * Returns the cells of the path of a word, by number.
+     */
+    const unsigned int* path(unsigned int w) const {
+        return &cells[ starts[w] ];
+    }
+
+    /**
+     * Returns the number of cells on the path of a word, by number.
+     */
+    unsigned int pathLength(unsigned int w) const {
+        return starts[w+1] - starts[w];
+    }
+
+    /**
+     * Returns the number of a word, or -1 if it was not found.
+     */
+    int find(const string& word) const;
+
+    /**
+     * Returns the path of a word as isOnBoard() does, or an empty
+     * vector if it was not found.
+     */
+    vector<int> getPath(const string& word) const;
+
+    /**
+     * Takes a word and its path from a search.
+     */
+    void word(const char* data, unsigned int length,
+              const unsigned int* path, unsigned int cells);
+
+};
+
+/**
+ * A subtree of a board search, to be searched by any thread.
+ *
+ * The path so far runs through the cells in path, is spelt by
+ * prefix, ends next to cell, and has left the lexicon at cursor;
+ * the subtree holds every extension of the path through cell.
+ * The cells on the path are also the set bits of visited, or of
+ * wide on boards of more than 64 cells.
+ */
+struct SearchTask {
+    unsigned int cell;
+    LexiconCursor cursor;
+    unsigned long long visited;
+    vector<unsigned long long> wide;
+    string prefix;
+    vector<unsigned int> path;
+};
+
+/**
+ * Timing of one parallel board search, for benchmarks.
+ *
+ * busy and finished hold, for every thread, the CPU seconds it
+ * spent searching and the time from the start at which it ran out
+ * of work for good.
+ */
+struct SearchStats {
+    double seconds;
+    vector<double> busy;
+    vector<double> finished;
+    unsigned int tasks;
+    unsigned int steals;
+};
+
+/**
+ * Hands SearchTasks out to a fixed set of threads.
+ *
+ * Every thread has its own queue: it adds tasks to and takes them
+ * from the back, while threads that ran out of work steal from the
+ * front of the others'. A thread searching near the root splits
+ * off subtrees as tasks only while some other thread is waiting
+ * for work, so a skewed board keeps every thread busy to the end
+ * and an even one pays almost nothing for it. A thread which finds
+ * nothing to steal sleeps until a task is queued or the last one
+ * is searched, rather than spinning on the queues.
+ */
+class TaskPool {
+
+private:
+    /**
+     * The tasks queued by one thread.
+     */
+    struct Queue {
+        std::mutex lock;
+        std::deque<SearchTask> tasks;
+    };
+
+    unsigned int threads;
+    std::unique_ptr<Queue[]> queues;
+    std::atomic<unsigned int> queued;
+    std::atomic<unsigned int> pending;
+    std::atomic<unsigned int> hungry;
+    std::mutex idle;
+    std::condition_variable wake;
+    std::atomic<unsigned int> steals;
+    std::atomic<unsigned int> total;
+
+    TaskPool(const TaskPool&);
+    TaskPool& operator=(const TaskPool&);
+
+public:
+    // paths of up to this many dice may be split off as tasks
+    static const unsigned int SPLIT_DEPTH = 4;
+
+    /**
+     * Constructs a TaskPool for the given number of threads.
+     */
+    TaskPool(unsigned int threads);
+
+    /**
+     * Queues a task on behalf of a thread, taking its contents.
+     */
+    void push(unsigned int thread, SearchTask& task);
+
+    /**
+     * Takes a task for a thread, stealing one if its own queue is
+     * empty, and sleeping while other threads may still split some.
+     *
+     * Returns false once every task has been searched.
+     */
+    bool take(unsigned int thread, SearchTask& task);
+
+    /**
+     * Marks a task taken with take() as searched.
+     */
+    void done();
+
+    /**
+     * Judges whether a thread is waiting for work.
+     */
+    bool wantsWork() const {
+        return hungry.load( std::memory_order_relaxed ) > 0;
+    }
+
+    /**
+     * Returns the number of tasks queued so far.
+     */
+    unsigned int tasks() const { return total.load(); }
+
+    /**
+     * Returns the number of tasks stolen so far.
+     */
+    unsigned int stolen() const { return steals.load(); }
+
+};
+
+/**
+ * Searches a BoardGrid for all the words a lexicon contains.
+ *
+ * L is TST or DAWG. Every path is extended one die at a time,
+ * advancing a lexicon cursor by that die's face only, and
+ * abandoned as soon as the cursor falls off the lexicon. str
+ * holds the letters of the current path and path its cells, so
+ * every word goes to the sink with the path it was found along.
+ */
+template<class L>
+class GridSearch {
+
+private:
+    const BoardGrid& grid;
+    const L& lex;
+    unsigned int min;
+    WordSink* sink;
+    WordSet found;
+    string str;
+    vector<unsigned int> path;
+    vector<unsigned long long> wide;
+    unsigned int depth;
+    TaskPool* pool;
+    unsigned int thread;
+    unsigned int split;
+
+    /**
+     * Queues the subtree through a cell next to the current path
+     * as a task.
+     */
+    void spawn(unsigned int cell, const LexiconCursor& cursor,
+               unsigned long long visited);
+
+    /**
+     * Extends the current path by a cell, on boards of at most
+     * 64 cells; visited has a bit set for every cell on the path.
+     */
+    void searchMask(unsigned int cell, LexiconCursor cursor,
+                    unsigned long long visited);
+
+    /**
+     * Extends the current path by a cell, on boards of any size;
+     * the visited cells are the set bits of wide.
+     */
+    void searchWide(unsigned int cell, LexiconCursor cursor);
+
+public:
+    /**
+     * Constructs a GridSearch which passes the words of at least
+     * min letters to sink, each once.
+     */
+    GridSearch(const BoardGrid& grid, const L& lex,
+               unsigned int min, WordSink* sink);
+
+    /**
+     * Finds all the words on paths starting at a cell.
+     */
+    void searchFrom(unsigned int cell);
+
+    /**
+     * Forgets the words found so far and fits the scratch to the
+     * board, which may have been reassigned since the search was
+     * constructed.
+     */
+    void reset();
+
+    /**
+     * Sets the minimum length of the words the next searches pass
+     * on, and the sink they pass them to.
+     */
+    void bind(unsigned int min, WordSink* sink);
+
+    /**
+     * Lets the search split subtrees of paths of at most split
+     * dice into pool, on behalf of a thread, while another thread
+     * is waiting for work.
+     */
+    void share(TaskPool* pool, unsigned int thread, unsigned int split);
+
+    /**
+     * Finds all the words in the subtree of a task.
+     */
+    void search(SearchTask& task);
+
+};
+
+/**
+ * Returns the bits of a row of cols cells covering a column and
+ * the columns either side of it.
+ */
+constexpr unsigned long long spanMask(unsigned int cols, unsigned int col) {
+    return ( col > 0 ? 1ull << ( col - 1 ) : 0 ) | 1ull << col
+         | ( col + 1 < cols ? 1ull << ( col + 1 ) : 0 );
+}
+
+/**
+ * Returns the neighbours of a cell of a rows by cols board as a
+ * bit mask, as BoardGrid::adjMask holds them.
+ */
+constexpr unsigned long long neighbourMask(unsigned int rows,
+                                           unsigned int cols,
+                                           unsigned int cell) {
+    return ( ( cell / cols > 0
+                 ? spanMask( cols, cell % cols ) << ( cell / cols - 1 ) * cols
+                 : 0 )
+           | spanMask( cols, cell % cols ) << cell / cols * cols
+           | ( cell / cols + 1 < rows
+                 ? spanMask( cols, cell % cols ) << ( cell / cols + 1 ) * cols
+                 : 0 ) )
+           & ~( 1ull << cell );
+}
+
+/**
+ * The cell numbers 0 up to N, as a parameter pack.
+ */
+template<unsigned int... I>
+struct CellList {};
+
+template<unsigned int N, unsigned int... I>
+struct MakeCells : MakeCells<N - 1, N - 1, I...> {};
+
+template<unsigned int... I>
+struct MakeCells<0, I...> {
+    typedef CellList<I...> type;
+};
+
+/**
+ * Holds the neighbour masks of every cell of a board of R rows and
+ * C columns, computed at compile time.
+ */
+template<unsigned int R, unsigned int C,
+         class Cells = typename MakeCells<R * C>::type>
+struct BoardShape;
+
+template<unsigned int R, unsigned int C, unsigned int... I>
+struct BoardShape<R, C, CellList<I...> > {
+    static constexpr unsigned int CELLS = R * C;
+    static constexpr unsigned long long adj[CELLS] = {
+        neighbourMask( R, C, I )...
+    };
+};
+
+template<unsigned int R, unsigned int C, unsigned int... I>
+constexpr unsigned long long BoardShape<R, C, CellList<I...> >::adj[];
+
+/**
+ * Searches a board of R rows and C columns for all the words a
+ * lexicon contains, as a single-threaded searchGrid() does.
+ *
+ * With the shape fixed at compile time, the neighbours of a cell
+ * come from BoardShape's constant table, the visited cells are one
+ * 32-bit mask, and the path and its letters live in buffers sized
+ * once for the board, passed down by length, so nothing is undone
+ * on the way back. Start cells and neighbours are tried in the
+ * same order as GridSearch, so every word gets the same path. A
+ * FixedSearch kept across boards of its shape reuses its buffers.
+ */
+template<class L, unsigned int R, unsigned int C>
+class FixedSearch {
+
+private:
+    typedef BoardShape<R, C> Shape;
+    static_assert(R * C <= 32, "visited cells must fit 32 bits");
+
+    const BoardGrid& grid;
+    const L& lex;
+    unsigned int min;
+    WordSink* sink;
+    WordSet found;
+    const char* faceData[R * C];
+    unsigned int faceLength[R * C];
+    unsigned int path[R * C];
+    vector<char> text;
+
+    /**
+     * Extends a path of depth cells spelling length characters by
+     * a cell; visited has a bit set for every cell on the path.
+     */
+    void extend(unsigned int cell, LexiconCursor cursor,
+                unsigned int visited, unsigned int depth,
+                unsigned int length);
+
+public:
+    /**
+     * Constructs a FixedSearch of a board of R rows and C columns
+     * which passes the words of at least min letters to sink, each
+     * once.
+     */
+    FixedSearch(const BoardGrid& grid, const L& lex,
+                unsigned int min, WordSink* sink);
+
+    /**
+     * Sets the minimum length of the words the next searches pass
+     * on, and the sink they pass them to.
+     */
+    void bind(unsigned int min, WordSink* sink);
+
+    /**
+     * Finds all the words on the board, as it is now; a board
+     * reassigned since the last search is searched afresh.
+     */
+    void search();
+
+};
+
+/**
+ * Keeps the searches one thread needs for every shape of board:
+ * a FixedSearch each for 4x4 and 5x5 boards, and a GridSearch for
+ * the rest.
+ *
+ * Boards assigned one after another to the same BoardGrid and
+ * searched through one SearchSet reuse the buffers of the search
+ * for their shape, so once those have grown to fit, a search
+ * allocates nothing.
+ */
+template<class L>
+class SearchSet {
+
+private:
+    const BoardGrid& grid;
+    GridSearch<L> walk;
+    FixedSearch<L, 4, 4> small;
+    FixedSearch<L, 5, 5> medium;
+
+public:
+    /**
+     * Constructs a SearchSet for a board and a lexicon, which must
+     * outlive it, passing the words of at least min letters to
+     * sink.
+     */
+    SearchSet(const BoardGrid& grid, const L& lex,
+              unsigned int min, WordSink* sink);
+
+    /**
+     * Sets the minimum length of the words the next searches pass
+     * on, and the sink they pass them to.
+     */
+    void bind(unsigned int min, WordSink* sink);
+
+    /**
+     * Finds all the words on the board, as it is now, with the
+     * search for its shape.
+     */
+    void search();
+
+};
+
+/**
+ * Finds all the words of at least min letters on a board which a
+ * lexicon contains, and passes each to sink once, as soon as it is
+ * found.
+ *
+ * With more than one thread, every start cell is queued in a
+ * TaskPool and subtrees of paths of at most split dice may be
+ * split off as well. Every thread drops the words it found before,
+ * and passes the rest through one shared WordSet under a lock, so
+ * sink is called by one thread at a time and sees the same words
+ * with any number of threads, in another order. If stats is set,
+ * it is filled in.
+ */
+template<class L>
+void searchGrid(const BoardGrid& grid, const L& lex, unsigned int min,
+                WordSink* sink, unsigned int threads = 1,
+                unsigned int split = TaskPool::SPLIT_DEPTH,
+                SearchStats* stats = nullptr);
+
+#endif // BOGGLEGRID_H
@@ -0,0 +1,134 @@
+#include "bogglelexicon.h"
+
+const unsigned int LexiconHandle::SLOTS;
+const unsigned int LexiconHandle::SLOT_SHIFT;
+const unsigned long long LexiconHandle::READERS_MASK;
+
+// serial of the next LexiconVersion, process-wide
+static std::atomic<unsigned long long> nextSerial( 1 );
+
+/**
+ * Constructs an empty LexiconVersion using the TST.
+ */
+LexiconVersion::LexiconVersion()
+    : lexicon(&tst), words(0), serial(nextSerial++) {}
+
+/**
+ * Returns the words of the lexicon with their letter
+ * signatures, computing them on the first call.
+ */
+const LexiconFilter& LexiconVersion::getFilter() {
+    std::call_once( filtered, [this]() { filter.build( *lexicon ); } );
+    return filter;
+}
+
+/**
+ * Constructs a LexiconHandle holding an empty version.
+ */
+LexiconHandle::LexiconHandle() : current(0) {
+    for ( unsigned int i = 0; i < SLOTS; i++ ) {
+        slots[i].version.store( nullptr );
+        slots[i].readers.store( 0 );
+    }
+    slots[0].version.store( new LexiconVersion() );
+}
+
+/**
+ * Destructs a LexiconHandle.
+ *
+ * No Reader may outlive it.
+ */
+LexiconHandle::~LexiconHandle() {
+    for ( unsigned int i = 0; i < SLOTS; i++ ) {
+        delete slots[i].version.load();
+    }
+}
+
+/**
+ * Pins the current version and returns its slot.
+ */
+unsigned int LexiconHandle::acquire() {
+    return current.fetch_add( 1 ) >> SLOT_SHIFT;
+}
+
+/**
+ * Unpins the version in a slot, deleting it if this was the
+ * last reference to a replaced version.
+ */
+void LexiconHandle::release( unsigned int slot ) {
+    unsigned long long word = current.load();
+
+    // still published: this reader is counted in current; a slot
+    // is never republished while it has readers, so a matching
+    // slot means the same publication
+    while ( ( word >> SLOT_SHIFT ) == slot ) {
+        if ( current.compare_exchange_weak( word, word - 1 ) ) {
+            return;
+        }
+    }
+
+    // replaced: the writer moved the count into the slot
+    if ( slots[slot].readers.fetch_sub( 1 ) == 1 ) {
+        reclaim( slot );
+    }
+}
+
+/**
+ * Deletes the version in a slot and frees the slot, waking the
+ * writers waiting for one.
+ */
+void LexiconHandle::reclaim( unsigned int slot ) {
+    delete slots[slot].version.load();
+    slots[slot].version.store( nullptr );
+
+    // taking the lock orders the store before a waiting writer's
+    // next scan, so the wakeup cannot fall between its scan and wait
+    std::lock_guard<std::mutex> lock( claiming );
+    freed.notify_all();
+}
+
+/**
+ * Puts a version in a free slot and returns the slot, waiting
+ * while every slot holds a version with readers.
+ */
+unsigned int LexiconHandle::claim( LexiconVersion* version ) {
+    std::unique_lock<std::mutex> lock( claiming );
+    unsigned int slot;
+
+    while ( 1 ) {
+        for ( slot = 0; slot < SLOTS; slot++ ) {
+            if ( slots[slot].version.load() == nullptr ) {
+                slots[slot].readers.store( 0 );
+                slots[slot].version.store( version );
+                return slot;
+            }
+        }
+        freed.wait( lock );
+    }
+}
+
+/**
+ * Replaces the current version with a new one, taking
+ * ownership of it.
+ *
+ * Readers already holding the old version keep using it;
+ * every later Reader sees the new one. Writers only share the
+ * lock for the scan of the slots, and hold nothing while they
+ * wait for one to free; each writer settles the count of the
+ * version its own exchange replaced, so concurrent writers need
+ * no other ordering.
+ */
+void LexiconHandle::publish( LexiconVersion* version ) {
+    unsigned int slot = claim( version ), previous;
+    unsigned long long old;
+    long long pinned;
+
+    old = current.exchange( (unsigned long long)slot << SLOT_SHIFT );
+    previous = old >> SLOT_SHIFT;
+    pinned = old & READERS_MASK;
+
+    // readers which left already drove the counter below zero
+    if ( slots[previous].readers.fetch_add( pinned ) + pinned == 0 ) {
+        reclaim( previous );
+    }
+}
@@ -0,0 +1,185 @@
+#ifndef BOGGLELEXICON_H
+#define BOGGLELEXICON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "boggleutil.h"
+#include "boggledawg.h"
+#include "bogglesnapshot.h"
+#include "bogglefilter.h"
+
+/**
+ * Represents one published version of a lexicon.
+ *
+ * Holds a TST or a DAWG, the snapshot mapping it may be attached
+ * to, and a pointer to whichever of the two is in use. A version
+ * is filled in before it is published and never changed after,
+ * except for its LexiconFilter, which is built once on first use.
+ * serial tells versions apart even where one reuses the address
+ * of another that was deleted. words is the number of words, or 0
+ * if it is not known, as for a lexicon attached from a snapshot.
+ */
+class LexiconVersion {
+
+private:
+    LexiconFilter filter;
+    std::once_flag filtered;
+
+    LexiconVersion(const LexiconVersion&);
+    LexiconVersion& operator=(const LexiconVersion&);
+
+public:
+    TST tst;
+    DAWG dawg;
+    LexiconSnapshot snapshot;
+    Lexicon* lexicon;
+    unsigned int words;
+    const unsigned long long serial;
+
+    /**
+     * Constructs an empty LexiconVersion using the TST.
+     */
+    LexiconVersion();
+
+    /**
+     * Judges whether the DAWG is in use.
+     */
+    bool isDAWG() { return lexicon == &dawg; }
+
+    /**
+     * Returns the words of the lexicon with their letter
+     * signatures, computing them on the first call.
+     */
+    const LexiconFilter& getFilter();
+
+};
+
+/**
+ * Holds the current LexiconVersion behind an atomically swappable,
+ * reference-counted handle.
+ *
+ * Readers pin the current version with one atomic increment and
+ * never wait for a writer. A writer puts its version in a free
+ * slot and publishes it in one atomic exchange; the old version is
+ * deleted by whichever thread drops its last reference, reader or
+ * writer, which then takes a lock just long enough to wake any
+ * writer waiting for the slot.
+ *
+ * The counts are split: the word current packs the slot of the
+ * published version with the number of readers which pinned it
+ * while published. A reader leaving while its version is still
+ * published takes itself off that count; once the version is
+ * replaced, the writer moves the count into the slot's own counter,
+ * which late readers then decrement.
+ */
+class LexiconHandle {
+
+public:
+    /**
+     * The most versions held at once, the published one and those
+     * replaced while readers still pin them.
+     */
+    static const unsigned int SLOTS = 64;
+
+private:
+    static const unsigned int SLOT_SHIFT = 48;
+    static const unsigned long long READERS_MASK =
+                                    ( 1ull << SLOT_SHIFT ) - 1;
+
+    /**
+     * A place for a version which may still have readers.
+     */
+    struct Slot {
+        std::atomic<LexiconVersion*> version;
+        std::atomic<long long> readers;
+    };
+
+    std::atomic<unsigned long long> current;
+    Slot slots[SLOTS];
+    std::mutex claiming;
+    std::condition_variable freed;
+
+    LexiconHandle(const LexiconHandle&);
+    LexiconHandle& operator=(const LexiconHandle&);
+
+    /**
+     * Pins the current version and returns its slot.
+     */
+    unsigned int acquire();
+
+    /**
+     * Unpins the version in a slot, deleting it if this was the
+     * last reference to a replaced version.
+     */
+    void release(unsigned int slot);
+
+    /**
+     * Deletes the version in a slot and frees the slot.
+     */
+    void reclaim(unsigned int slot);
+
+    /**
+     * Puts a version in a free slot and returns the slot, waiting
+     * while every slot holds a version with readers.
+     */
+    unsigned int claim(LexiconVersion* version);
+
+public:
+    /**
+     * Pins the current version for as long as it is in scope.
+     */
+    class Reader {
+
+    private:
+        LexiconHandle& handle;
+        unsigned int slot;
+
+        Reader(const Reader&);
+        Reader& operator=(const Reader&);
+
+    public:
+        Reader(LexiconHandle& handle)
+            : handle(handle), slot(handle.acquire()) {}
+
+        ~Reader() { handle.release( slot ); }
+
+        LexiconVersion* operator->() {
+            return handle.slots[slot].version.load();
+        }
+
+        LexiconVersion& operator*() {
+            return *handle.slots[slot].version.load();
+        }
+
+    };
+
+    /**
+     * Constructs a LexiconHandle holding an empty version.
+     */
+    LexiconHandle();
+
+    /**
+     * Destructs a LexiconHandle.
+     *
+     * No Reader may outlive it.
+     */
+    ~LexiconHandle();
+
+    /**
+     * Replaces the current version with a new one, taking
+     * ownership of it.
+     *
+     * Readers already holding the old version keep using it;
+     * every later Reader sees the new one. Writers only share the
+     * lock for the scan of the slots, and hold nothing while they
+     * wait for one to free; each writer settles the count of the
+     * version its own exchange replaced, so concurrent writers need
+     * no other ordering.
+     */
+    void publish(LexiconVersion* version);
+
+};
+
+#endif // BOGGLELEXICON_H
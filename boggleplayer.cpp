@@ -1,25 +1,8 @@
 #include "boggleplayer.h"
 
-/**
- * Destructs a BogglePlayer.
- */
-BogglePlayer::~BogglePlayer() {
-    if ( board != nullptr ) {
-        for ( int i = 0; i < (int)rows; i++ ) {
-            for ( int j = 0; j < (int)cols; j++ ) {
-                delete board[i][j];
-            }
-        }
-
-        for ( int i = 0; i < (int)rows; i++ ) {
-            delete[] board[i];
-        }
-
-        delete[] board;
-
-        board = nullptr;
-    }
-}
+// the board filter is used only if it leaves at most this
+// fraction of the lexicon
+static const unsigned int PRUNE_DIVISOR = 4;
 
 /**
  * Builds the lexicon.
@@ -31,34 +14,209 @@ BogglePlayer::~BogglePlayer() {
 void BogglePlayer::buildLexicon( const set<string>& word_list ) {
 
     set<string>::const_iterator it;
-    vector<string*> v;
-    string *str, *temp;
-    int rdIndex, sz;
-    random_device rd;
+    vector<WordRef> refs;
 
+    // the set is already sorted, so the lexicon can be built
+    // straight from references into it
+    refs.reserve( word_list.size() );
     for ( it = word_list.begin(); it != word_list.end(); ++it ) {
-        str = new string( *it );
-        v.push_back( str );
+        WordRef ref = { it->data(), (unsigned int)( it->length() ) };
+        refs.push_back( ref );
     }
 
-    sz = (int)( v.size() );
+    buildSorted( refs.data(), refs.size() );
+}
+
+/**
+ * Builds the lexicon from a buffer holding one word per line.
+ *
+ * Words are lowercased and duplicates dropped, as BoggleBoard
+ * does, but without building a set of strings first.
+ */
+void BogglePlayer::buildLexicon( const char* buffer, size_t length ) {
+    WordList list;
+    list.parse( buffer, length );
+    buildSorted( list.refs.data(), list.refs.size() );
+}
+
+/**
+ * Builds the lexicon from a range of words in any order and case.
+ */
+void BogglePlayer::buildLexicon( const WordRef* words, unsigned int count ) {
+    WordList list;
+    list.assign( words, count );
+    buildSorted( list.refs.data(), list.refs.size() );
+}
+
+/**
+ * Builds the lexicon from a file holding one word per line.
+ *
+ * Returns false, keeping the current lexicon, if the file cannot
+ * be read.
+ */
+bool BogglePlayer::loadLexicon( const char* path ) {
+    WordList list;
+    if ( !list.read( path ) ) {
+        return 0;
+    }
+    buildSorted( list.refs.data(), list.refs.size() );
+    return 1;
+}
 
-    for ( int i = 0; i < sz; i++ ) {
-        rdIndex = rd() % ( sz - i ) + i;
-        temp = v[rdIndex];
-        v[rdIndex] = v[i];
-        v[i] = temp;
+/**
+ * Builds the lexicon from sorted, distinct, lowercase words.
+ */
+void BogglePlayer::buildSorted( const WordRef* words, unsigned int count ) {
+    LexiconVersion *version = new LexiconVersion();
+
+    version->words = count;
+    if ( type == DAWG_LEXICON ) {
+        DAWGBuilder builder( &version->dawg );
+        for ( unsigned int i = 0; i < count; i++ ) {
+            builder.add( words[i].data, words[i].length );
+        }
+        if ( builder.finish() ) {
+            version->lexicon = &version->dawg;
+            lexicons.publish( version );
+            return;
+        }
+        // too large for the DAWG's state indices; use a TST instead
     }
 
-    tst.clear();
+    version->tst.build( words, count, buildThreads );
+    version->tst.compact();
+
+    lexicons.publish( version );
+}
+
+/**
+ * Selects the lexicon structure.
+ *
+ * Takes effect at the next call to buildLexicon().
+ */
+void BogglePlayer::setLexiconType( LexiconType type ) {
+    this->type = type;
+}
 
-    for ( int i = 0; i < sz; i++ ) {
-        tst.insert( *( v[i] ) );
+/**
+ * Sets how many threads build a TST lexicon.
+ *
+ * 0 uses one thread per hardware thread.
+ */
+void BogglePlayer::setBuildThreads( unsigned int threads ) {
+    if ( threads == 0 ) {
+        threads = std::thread::hardware_concurrency();
     }
+    buildThreads = threads > 0 ? threads : 1;
+}
 
-    for ( int i = 0; i < sz; i++ ) {
-        delete v[i];
+/**
+ * Sets how many threads getAllValidWords() searches with.
+ *
+ * 0 uses one thread per hardware thread.
+ */
+void BogglePlayer::setSolveThreads( unsigned int threads ) {
+    if ( threads == 0 ) {
+        threads = std::thread::hardware_concurrency();
     }
+    solveThreads = threads > 0 ? threads : 1;
+}
+
+/**
+ * Selects whether getAllValidWords() searches a lexicon cut
+ * down to the board.
+ */
+void BogglePlayer::setBoardFilter( bool enabled ) {
+    filterBoard = enabled;
+}
+
+/**
+ * Selects how getAllValidWords() finds the words on the board.
+ */
+void BogglePlayer::setSolveStrategy( SolveStrategy strategy ) {
+    this->strategy = strategy;
+}
+
+/**
+ * Sets how many boards getAllValidWords() keeps the words of, so
+ * a board seen again, turned or mirrored or not, is not searched.
+ *
+ * 0 turns the cache off.
+ */
+void BogglePlayer::setResultCache( unsigned int boards ) {
+    cache.setCapacity( boards );
+}
+
+/**
+ * Writes the lexicon to a snapshot file.
+ *
+ * Returns false if there is no lexicon or the file cannot be
+ * written.
+ */
+bool BogglePlayer::saveLexicon( const char* path ) {
+    LexiconHandle::Reader lex( lexicons );
+    vector<unsigned char> nodes;
+
+    if ( lex->lexicon->isEmpty() ) {
+        return 0;
+    }
+
+    if ( lex->isDAWG() ) {
+        return LexiconSnapshot::write( path, DAWG_LEXICON,
+                                       lex->dawg.getRoot(), lex->dawg.data(),
+                                       lex->dawg.size(), sizeof( unsigned int ) );
+    }
+
+    // the nodes' padding bytes are not theirs to write
+    lex->tst.copyNodes( nodes );
+    return LexiconSnapshot::write( path, TST_LEXICON, 0, nodes.data(),
+                                   lex->tst.size(), sizeof( TSTNode<char> ) );
+}
+
+/**
+ * Uses the lexicon in a snapshot file written by saveLexicon().
+ *
+ * The file is mapped and queried in place, with no parsing or
+ * copying, until the next buildLexicon() or attachLexicon().
+ * Returns false, keeping the current lexicon, if the file is
+ * missing, was written by another version or host, or holds an
+ * index past its last node or edge.
+ */
+bool BogglePlayer::attachLexicon( const char* path ) {
+    LexiconVersion *version;
+    LexiconSnapshot opened;
+    const SnapshotHeader *h;
+
+    if ( !opened.open( path ) ) {
+        return 0;
+    }
+
+    h = opened.header();
+    version = new LexiconVersion();
+    // attach() checks every index against the count, so a corrupt
+    // file is refused rather than read out of bounds
+    if ( h->type == DAWG_LEXICON
+            && h->entrySize == sizeof( unsigned int )
+            && version->dawg.attach( (const unsigned int*)opened.entries(),
+                                     h->count, h->root ) ) {
+        version->lexicon = &version->dawg;
+        type = DAWG_LEXICON;
+    }
+    else if ( h->type == TST_LEXICON
+                 && h->entrySize == sizeof( TSTNode<char> )
+                 && version->tst.attach( (const TSTNode<char>*)opened.entries(),
+                                         h->count ) ) {
+        type = TST_LEXICON;
+    }
+    else {
+        delete version;
+        return 0;
+    }
+
+    // the mapping is released with the version
+    version->snapshot.swap( opened );
+    lexicons.publish( version );
+    return 1;
 }
 
 /**
@@ -73,58 +231,93 @@ void BogglePlayer::setBoard( unsigned int rows,
                              string** diceArray ) {
     if ( diceArray == nullptr ) return;
 
-    if ( board != nullptr ) {
-        for ( int i = 0; i < (int)rows; i++ ) {
-            for ( int j = 0; j < (int)cols; j++ ) {
-                delete board[i][j];
-            }
-        }
+    grid.assign( rows, cols, diceArray );
+    treeFrom = 0;
 
-        for ( int i = 0; i < (int)rows; i++ ) {
-            delete[] board[i];
-        }
+    letters = LetterSignature();
+    for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+        letters.add( grid.faceAt( cell ).data(),
+                     grid.faceAt( cell ).length() );
+    }
+    prunedFrom = 0;
+}
 
-        delete[] board;
+/**
+ * Changes the face of one die of the board.
+ *
+ * Returns false, changing nothing, if there is no such die.
+ */
+bool BogglePlayer::updateCell( unsigned int row, unsigned int col,
+                               const string& face ) {
+    LexiconHandle::Reader lex( lexicons );
+    unsigned int cell = row * grid.cols + col;
 
-        board = nullptr;
+    if ( row >= grid.rows || col >= grid.cols ) {
+        return 0;
     }
 
-    this->rows = rows;
-    this->cols = cols;
+    grid.setFace( cell, face );
+    letters = LetterSignature();
+    for ( unsigned int c = 0; c < grid.size; c++ ) {
+        letters.add( grid.faceAt( c ).data(), grid.faceAt( c ).length() );
+    }
+    prunedFrom = 0;
 
-    board = new Node**[rows];
-    for ( int i = 0; i < (int)rows; i++ ) {
-        board[i] = new Node*[cols];
+    if ( grid.size > BoardGrid::MASK_CELLS || lex->lexicon->isEmpty() ) {
+        treeFrom = 0;
+        return 1;
     }
 
-    for ( int i = 0; i < (int)rows; i++ ) {
-        for ( int j = 0; j < (int)cols; j++ ) {
-            board[i][j] = new Node( diceArray[i][j], i * cols + j );
-        }
+    // a tree from another lexicon, or none yet, is built in full
+    if ( treeFrom != lex->serial ) {
+        if ( lex->isDAWG() ) tree.build( lex->dawg );
+        else tree.build( lex->tst );
+        treeFrom = lex->serial;
+    }
+    else if ( lex->isDAWG() ) {
+        tree.update( lex->dawg, cell );
+    }
+    else {
+        tree.update( lex->tst, cell );
     }
+    return 1;
+}
 
-    for ( int i = 0; i < (int)rows; i++ ) {
-        for ( int j = 0; j < (int)cols; j++ ) {
-            if ( i - 1 >= 0 && j - 1 >= 0 )
-                board[i][j]->addNeighbour( board[i-1][j-1] );
-            if ( i - 1 >= 0 )
-                board[i][j]->addNeighbour( board[i-1][j] );
-            if ( i - 1 >= 0 && j + 1 < (int)cols )
-                board[i][j]->addNeighbour( board[i-1][j+1] );
-            if ( j - 1 >= 0 )
-                board[i][j]->addNeighbour( board[i][j-1] );
-            if ( j + 1 < (int)cols )
-                board[i][j]->addNeighbour( board[i][j+1] );
-            if ( i + 1 < (int)rows && j - 1 >= 0 )
-                board[i][j]->addNeighbour( board[i+1][j-1] );
-            if ( i + 1 < (int)rows )
-                board[i][j]->addNeighbour( board[i+1][j] );
-            if ( i + 1 < (int)rows && j + 1 < (int)cols )
-                board[i][j]->addNeighbour( board[i+1][j+1] );
-        }
+/**
+ * Searches a board with a SearchSet kept from earlier boards, if
+ * the search has one thread, or else with searchGrid().
+ */
+template<class L>
+static void solve( const BoardGrid& grid, const L& lex,
+                   SearchSet<L>& searches, unsigned int min,
+                   WordSink* sink, unsigned int threads ) {
+    if ( threads == 1 ) {
+        searches.bind( min, sink );
+        searches.search();
+    }
+    else {
+        searchGrid( grid, lex, min, sink, threads );
     }
 }
 
+/**
+ * Inserts the words of a search into a set of strings.
+ */
+class SetSink : public WordSink {
+
+private:
+    set<string>* words;
+
+public:
+    SetSink( set<string>* words ) : words(words) {}
+
+    void word( const char* data, unsigned int length,
+               const unsigned int* path, unsigned int cells ) {
+        words->insert( string( data, length ) );
+    }
+
+};
+
 /**
  * Gets all the words which both board and lexicon contain.
  *
@@ -133,23 +326,190 @@ void BogglePlayer::setBoard( unsigned int rows,
  */
 bool BogglePlayer::getAllValidWords( unsigned int minimum_word_length,
                                                    set<string>* words ) {
-    if ( board == nullptr || tst.isEmpty() ) {
+    SetSink sink( words );
+    return getAllValidWords( minimum_word_length, &sink );
+}
+
+/**
+ * Passes all the words which both board and lexicon contain to
+ * a sink, each once, as soon as the search finds it.
+ *
+ * Returns false, passing nothing, if there is no board or no
+ * lexicon.
+ */
+bool BogglePlayer::getAllValidWords( unsigned int minimum_word_length,
+                                                   WordSink* sink ) {
+    LexiconHandle::Reader lex( lexicons );
+
+    if ( grid.size == 0 || lex->lexicon->isEmpty() ) {
         return 0;
     }
 
-    for ( int i = 0; i < (int)rows; i++ ) {
-        for ( int j = 0; j < (int)cols; j++ ) {
-            for ( int m = 0; m < (int)rows; m++ ) {
-                for ( int n = 0; n < (int)cols; n++ ) {
-                    board[m][n]->setVisited( 0 );
-                }
-            }
-            board[i][j]->searchValid( minimum_word_length, words, tst );
+    // kept up to date by updateCell()
+    if ( treeFrom == lex->serial ) {
+        tree.report( minimum_word_length, sink );
+        return 1;
+    }
+
+    // a missed board is searched for every word, so later lookups
+    // with a smaller minimum find them too
+    if ( cache.getCapacity() > 0 ) {
+        if ( !cache.lookup( grid, lex->serial, minimum_word_length, sink ) ) {
+            ResultCache::Recorder recorder( &cache, minimum_word_length,
+                                            sink );
+            search( *lex, 0, &recorder );
+            cache.store();
         }
+        return 1;
+    }
+
+    search( *lex, minimum_word_length, sink );
+    return 1;
+}
+
+/**
+ * Searches the board for the words of at least min letters of a
+ * lexicon version, by the strategy set, passing them to sink.
+ */
+void BogglePlayer::search( LexiconVersion& version, unsigned int min,
+                           WordSink* sink ) {
+    // the word count of an attached lexicon is not known
+    if ( strategy == LEXICON_STRATEGY
+           || ( strategy == AUTO_STRATEGY && version.words != 0
+                  && preferScan( grid.size, version.words ) ) ) {
+        scan.reset();
+        scan.scan( version.getFilter(), letters, min, sink );
+        return;
+    }
+
+    if ( filterBoard && prunedFrom != version.serial ) {
+        prune( version );
+    }
+
+    // the searches hold on to the lexicon they were made for
+    if ( searchFrom != version.serial ) {
+        searchTST.reset( new SearchSet<TST>( grid, version.tst, 0, nullptr ) );
+        searchDAWG.reset( new SearchSet<DAWG>( grid, version.dawg, 0,
+                                               nullptr ) );
+        searchFrom = version.serial;
+    }
+
+    if ( filterBoard && prunedUsed ) {
+        solve( grid, pruned, searchPruned, min, sink, solveThreads );
+    }
+    else if ( version.isDAWG() ) {
+        solve( grid, version.dawg, *searchDAWG, min, sink, solveThreads );
+    }
+    else {
+        solve( grid, version.tst, *searchTST, min, sink, solveThreads );
+    }
+}
+
+/**
+ * Finds the words of at least minimum_word_length letters on every
+ * board of a batch, into results, keeping the words too if words
+ * is set.
+ *
+ * Returns false, finding nothing, if there is no lexicon.
+ */
+bool BogglePlayer::solveBatch( const BoardBatch& boards,
+                               unsigned int minimum_word_length,
+                               BatchResults* results, bool words,
+                               unsigned int threads ) {
+    LexiconHandle::Reader lex( lexicons );
+
+    if ( lex->lexicon->isEmpty() ) {
+        return 0;
+    }
+
+    if ( threads == 0 ) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if ( threads == 0 ) {
+        threads = 1;
+    }
+
+    if ( lex->isDAWG() ) {
+        ::solveBatch( boards, lex->dawg, minimum_word_length, results,
+                      words, threads );
+    }
+    else {
+        ::solveBatch( boards, lex->tst, minimum_word_length, results,
+                      words, threads );
     }
     return 1;
 }
 
+/**
+ * Searches for the boards whose words in the lexicon score highest,
+ * rolled from a set of dice, into report.
+ *
+ * Returns false, finding nothing, if there is no lexicon, if the
+ * dice fail validDice() or if the board has no cells.
+ */
+bool BogglePlayer::annealBoards( const AnnealSettings& settings,
+                                 AnnealReport* report ) {
+    LexiconHandle::Reader lex( lexicons );
+
+    if ( lex->lexicon->isEmpty() || !validDice( settings.dice )
+         || settings.rows == 0 || settings.cols == 0 ) {
+        return 0;
+    }
+
+    if ( lex->isDAWG() ) {
+        ::annealBoards( lex->dawg, settings, report );
+    }
+    else {
+        ::annealBoards( lex->tst, settings, report );
+    }
+    return 1;
+}
+
+/**
+ * Rolls random boards from a set of dice and gathers the
+ * distributions of their words in the lexicon into report.
+ *
+ * Returns false, sampling nothing, if there is no lexicon, if the
+ * dice fail validDice() or if the board has no cells.
+ */
+bool BogglePlayer::sampleBoards( const SampleSettings& settings,
+                                 SampleReport* report ) {
+    LexiconHandle::Reader lex( lexicons );
+
+    if ( lex->lexicon->isEmpty() || !validDice( settings.dice )
+         || settings.rows == 0 || settings.cols == 0 ) {
+        return 0;
+    }
+
+    if ( lex->isDAWG() ) {
+        ::sampleBoards( lex->dawg, settings, report );
+    }
+    else {
+        ::sampleBoards( lex->tst, settings, report );
+    }
+    return 1;
+}
+
+/**
+ * Cuts a lexicon version down to the words whose letters the
+ * board holds, into pruned, unless too many of them remain.
+ */
+void BogglePlayer::prune( LexiconVersion& version ) {
+    const LexiconFilter& filter = version.getFilter();
+    vector<WordRef> selected;
+
+    prunedFrom = version.serial;
+    prunedUsed = filter.select( letters, filter.size() / PRUNE_DIVISOR,
+                                selected );
+    if ( prunedUsed ) {
+        pruned.build( selected.data(), selected.size() );
+        pruned.compact();
+    }
+    else {
+        pruned.clear();
+    }
+}
+
 /**
  * Checks whether a specified word is in the lexicon.
  *
@@ -162,7 +522,21 @@ bool BogglePlayer::getAllValidWords( unsigned int minimum_word_length,
  * has not yet been called.
  */
 bool BogglePlayer::isInLexicon( const string& word_to_check ) {
-    return tst.find( word_to_check );
+    LexiconHandle::Reader lex( lexicons );
+    return lex->lexicon->find( word_to_check );
+}
+
+/**
+ * Checks which of the specified words are in the lexicon.
+ *
+ * Takes an array of words and sets (*hits)[i] to whether
+ * words[i] is in the lexicon.
+ */
+void BogglePlayer::isInLexicon( const string* words,
+                                unsigned int count,
+                                vector<bool>* hits ) {
+    LexiconHandle::Reader lex( lexicons );
+    lex->lexicon->findMany( words, count, *hits );
 }
 
 /**
@@ -173,36 +547,36 @@ bool BogglePlayer::isInLexicon( const string& word_to_check ) {
  * path on the board specified by the most recent call to setBoard().
  */
 vector<int> BogglePlayer::isOnBoard( const string& word_to_check ) {
+    unsigned int n;
 
-    string s;
-    for ( int i = 0; i < (int)( word_to_check.length() ); i++ ) {
-        s += tolower( word_to_check[i] );
-    }
-
-    for ( int i = 0; i < (int)rows; i++ ) {
-        for ( int j = 0; j < (int)cols; j++ ) {
-            vector<int> v;
-
-            if ( !s.compare( 0, board[i][j]->getString().length(),
-                                         board[i][j]->getString() ) ) {
-                v.push_back( board[i][j]->getIndex() );
-
-                if ( !s.compare( board[i][j]->getString() ) ) {
-                    return v;
-                }
-
-                else if ( board[i][j]->getString().length() < s.length() ) {
+    cells.resize( grid.size );
+    n = isOnBoard( word_to_check, cells.data() );
+    return vector<int>( cells.begin(), cells.begin() + n );
+}
 
-                    pair<vector<int>, bool> p = board[i][j]->search
-                      ( s, v, board[i][j]->getString().length() );
+/**
+ * Checks whether a specified word is on the board, writing the path
+ * to a buffer instead of a new vector.
+ *
+ * path must have room for rows * cols cells. Returns the number of
+ * cells on the path, or 0 if the word is not on the board.
+ */
+unsigned int BogglePlayer::isOnBoard( const string& word_to_check,
+                                      unsigned int* path ) {
+    return finder.find( word_to_check.data(), word_to_check.length(),
+                                              path );
+}
 
-                    if ( p.second == 1 ) return p.first;
-                }
-            }
-        }
-    }
-    vector<int> v;
-    return v;
+/**
+ * Checks which of the specified words are on the board.
+ *
+ * Takes an array of words and sets (*paths)[i] to the path
+ * isOnBoard() returns for words[i].
+ */
+void BogglePlayer::isOnBoard( const string* words,
+                              unsigned int count,
+                              vector< vector<int> >* paths ) {
+    finder.findMany( words, count, *paths );
 }
 
 /**
@@ -5,40 +5,96 @@
 #include <vector>
 #include <string>
 #include <locale>
-#include <random>
+#include <memory>
+#include <thread>
 
 #include "baseboggleplayer.h"
 #include "boggleutil.h"
+#include "bogglelexicon.h"
+#include "bogglefilter.h"
+#include "bogglegrid.h"
+#include "bogglescan.h"
+#include "bogglebatch.h"
+#include "boggletree.h"
+#include "bogglecache.h"
+#include "boggleanneal.h"
+#include "bogglestats.h"
 
 using std::pair;
 using std::vector;
 using std::string;
 using std::locale;
-using std::random_device;
 
 /**
  * Represents a boggle.
  *
- * BogglePlayer contains a pointer to the board and a TST.
+ * BogglePlayer contains the board, as flat arrays searched with
+ * a bit mask of visited cells, and a handle to the lexicon, which
+ * is either a TST or a DAWG, built in memory or attached from a
+ * mapped snapshot. getAllValidWords() searches 4x4 and 5x5 boards
+ * with searches specialized for their shape, and may answer a
+ * board seen before from a ResultCache. The board's arrays and the
+ * searches' buffers are kept from one board to the next, so once
+ * they have grown to fit, setBoard() and a single-threaded
+ * getAllValidWords() allocate nothing. isOnBoard() searches the
+ * same arrays through an index of cells by the first letter of
+ * their face. A new lexicon is built aside and published in one
+ * step, so lookups running concurrently with buildLexicon() or
+ * attachLexicon() see either the old lexicon or the new one, never
+ * a partial one.
  */
 class BogglePlayer: public BaseBogglePlayer {
 
 private:
-    unsigned int rows;
-    unsigned int cols;
-    Node*** board;
-    TST tst;
+    BoardGrid grid;
+    std::unique_ptr< SearchSet<TST> > searchTST;
+    std::unique_ptr< SearchSet<DAWG> > searchDAWG;
+    unsigned long long searchFrom;
+    BoardScan scan;
+    PathFinder finder;
+    SearchTree tree;
+    unsigned long long treeFrom;
+    vector<unsigned int> cells;
+    LexiconType type;
+    unsigned int buildThreads;
+    unsigned int solveThreads;
+    SolveStrategy strategy;
+    LexiconHandle lexicons;
+    bool filterBoard;
+    LetterSignature letters;
+    TST pruned;
+    SearchSet<TST> searchPruned;
+    unsigned long long prunedFrom;
+    bool prunedUsed;
+    ResultCache cache;
 
-public:
     /**
-     * Constructs a BogglePlayer.
+     * Builds the lexicon from sorted, distinct, lowercase words.
+     */
+    void buildSorted(const WordRef* words, unsigned int count);
+
+    /**
+     * Cuts a lexicon version down to the words whose letters the
+     * board holds, into pruned, unless too many of them remain.
+     */
+    void prune(LexiconVersion& version);
+
+    /**
+     * Searches the board for the words of at least min letters of
+     * a lexicon version, by the strategy set, passing them to sink.
      */
-    BogglePlayer() : rows(0), cols(0), board(nullptr) {}
+    void search(LexiconVersion& version, unsigned int min, WordSink* sink);
 
+public:
     /**
-     * Destructs a BogglePlayer.
+     * Constructs a BogglePlayer.
      */
-    ~BogglePlayer();
+    BogglePlayer() : searchFrom(0), scan(grid), finder(grid),
+                     tree(grid), treeFrom(0),
+                     type(TST_LEXICON), buildThreads(1), solveThreads(1),
+                     strategy(AUTO_STRATEGY), filterBoard(0),
+                     searchPruned(grid, pruned, 0, nullptr),
+                     prunedFrom(0), prunedUsed(0) {}
 
     /**
      * Builds the lexicon.
@@ -49,6 +105,133 @@ public:
      */
     void buildLexicon(const set<string>& word_list);
 
+    /**
+     * Builds the lexicon from a buffer holding one word per line.
+     *
+     * Words are lowercased and duplicates dropped, as BoggleBoard
+     * does, but without building a set of strings first.
+     */
+    void buildLexicon(const char* buffer, size_t length);
+
+    /**
+     * Builds the lexicon from a range of words in any order and case.
+     */
+    void buildLexicon(const WordRef* words, unsigned int count);
+
+    /**
+     * Builds the lexicon from a file holding one word per line.
+     *
+     * Returns false, keeping the current lexicon, if the file cannot
+     * be read.
+     */
+    bool loadLexicon(const char* path);
+
+    /**
+     * Selects the lexicon structure.
+     *
+     * Takes effect at the next call to buildLexicon(). A DAWG
+     * shares common suffixes and is several times smaller than
+     * the TST, at a small cost per lookup.
+     */
+    void setLexiconType(LexiconType type);
+
+    /**
+     * Sets how many threads build a TST lexicon.
+     *
+     * Subtrees under different two-letter prefixes are built
+     * concurrently; the result is the same as a serial build.
+     * 0 uses one thread per hardware thread. The default is 1.
+     */
+    void setBuildThreads(unsigned int threads);
+
+    /**
+     * Sets how many threads getAllValidWords() searches with.
+     *
+     * Start cells are queued as tasks, and a thread searching near
+     * the root splits off subtrees for any thread left without
+     * work; every thread has its own visited set and result set,
+     * merged at the end, so the words are the same as with one
+     * thread. 0 uses one thread per hardware thread. The
+     * default is 1; only then are 4x4 and 5x5 boards searched by
+     * their specialized search.
+     */
+    void setSolveThreads(unsigned int threads);
+
+    /**
+     * Selects whether getAllValidWords() searches a lexicon cut
+     * down to the board.
+     *
+     * When enabled, the first getAllValidWords() after setBoard()
+     * drops every word needing a letter the dice do not hold, or
+     * holding one more often than the dice do, and searches what
+     * is left; later calls reuse it until the board or lexicon
+     * changes. That search is faster, but cutting the lexicon
+     * scans all of it, so this pays off when one board is solved
+     * several times. It is skipped when the board rules out less
+     * than three quarters of the lexicon. The default is disabled.
+     */
+    void setBoardFilter(bool enabled);
+
+    /**
+     * Selects how getAllValidWords() finds the words on the board.
+     *
+     * The board strategy walks every path of the board, following
+     * the lexicon as it goes; the lexicon strategy tests every word
+     * of the lexicon against all cells of the board at once, and
+     * wins for small lexicons on boards of any size, but for
+     * mid-sized lexicons only on small boards. Both find the same
+     * words with the same paths. The lexicon strategy runs on one
+     * thread and ignores setBoardFilter(). The default, automatic,
+     * picks one by board and lexicon size; a lexicon attached from
+     * a snapshot always gets the board strategy.
+     */
+    void setSolveStrategy(SolveStrategy strategy);
+
+    /**
+     * Sets how many boards getAllValidWords() keeps the words of.
+     *
+     * A board seen again is answered from the cache with no search:
+     * the board is looked up by the smallest key among its turns
+     * and mirrors, which share its words, and the paths kept are
+     * turned back to match. They spell the words on the board, but
+     * may differ from those a search of a turned board would give.
+     * Once the cache is full, the board used longest ago is
+     * dropped, and a new lexicon empties it; boards changed by
+     * updateCell() bypass it. Setting a size empties the cache and
+     * zeroes its counters. The default, 0, turns it off.
+     */
+    void setResultCache(unsigned int boards);
+
+    /**
+     * Returns how many getAllValidWords() calls the cache answered.
+     */
+    unsigned long long cacheHits() const { return cache.hits(); }
+
+    /**
+     * Returns how many getAllValidWords() calls missed the cache
+     * and searched the board.
+     */
+    unsigned long long cacheMisses() const { return cache.misses(); }
+
+    /**
+     * Writes the lexicon to a snapshot file.
+     *
+     * Returns false if there is no lexicon or the file cannot be
+     * written.
+     */
+    bool saveLexicon(const char* path);
+
+    /**
+     * Uses the lexicon in a snapshot file written by saveLexicon().
+     *
+     * The file is mapped and queried in place, with no parsing or
+     * copying, until the next buildLexicon() or attachLexicon().
+     * Returns false, keeping the current lexicon, if the file is
+     * missing, was written by another version or host, or holds an
+     * index past its last node or edge.
+     */
+    bool attachLexicon(const char* path);
+
     /**
      * Sets the board.
      *
@@ -58,15 +241,91 @@ public:
      */
     void setBoard(unsigned int rows, unsigned int cols, string** diceArray);
 
+    /**
+     * Changes the face of one die of the board.
+     *
+     * The first change keeps every path getAllValidWords() would
+     * follow on the board in a SearchTree, and every later change
+     * searches only the paths through the changed die; until the
+     * next setBoard() or a new lexicon, getAllValidWords() then
+     * reads the words off the tree, the same words with the same
+     * paths as a full search, without searching. Boards of more
+     * than 64 cells are searched in full. Returns false, changing
+     * nothing, if there is no such die.
+     */
+    bool updateCell(unsigned int row, unsigned int col, const string& face);
+
     /**
      * Gets all the words which both board and lexicon contain.
      *
      * Takes two arguments: an int specifying a minimum word length,
      * and a pointer to a set of strings.
+     *
+     * With setBoardFilter() enabled, the search walks a lexicon
+     * cut down to the words whose letters are all on the board.
      */
     bool getAllValidWords(unsigned int minimum_word_length,
                                         set<string>* words);
 
+    /**
+     * Passes all the words which both board and lexicon contain to
+     * a sink, each once, as soon as the search finds it.
+     *
+     * The set overload is built on this one; a sink sees the first
+     * word long before the search ends, and no string is made for
+     * it. Every word comes with the cells of a path spelling it, so
+     * a WordPaths sink answers isOnBoard() for all of them without
+     * searching the board again. With several solve threads, the
+     * sink is called by one of them at a time. Returns false,
+     * passing nothing, if there is no board or no lexicon.
+     */
+    bool getAllValidWords(unsigned int minimum_word_length,
+                                             WordSink* sink);
+
+    /**
+     * Finds the words of at least minimum_word_length letters on
+     * every board of a batch, into results, keeping the words too
+     * if words is set.
+     *
+     * The boards are solved on threads threads, or one per hardware
+     * thread if 0, each walking the lexicon as getAllValidWords()
+     * does with one thread, with scratch built once per thread; the
+     * board set by setBoard() is left alone. Returns false, finding
+     * nothing, if there is no lexicon.
+     */
+    bool solveBatch(const BoardBatch& boards,
+                    unsigned int minimum_word_length,
+                    BatchResults* results, bool words = 0,
+                    unsigned int threads = 0);
+
+    /**
+     * Searches for the boards whose words in the lexicon score
+     * highest, rolled from a set of dice, into report.
+     *
+     * Independent simulated-annealing chains run on several
+     * threads for a time budget, each turning and swapping the
+     * dice of its own board and solving it the way a single-threaded
+     * getAllValidWords() does, with scratch built once per chain;
+     * the board set by setBoard() is left alone. Returns false,
+     * finding nothing, if there is no lexicon, if the dice fail
+     * validDice() or if the board has no cells.
+     */
+    bool annealBoards(const AnnealSettings& settings, AnnealReport* report);
+
+    /**
+     * Rolls random boards from a set of dice and gathers how many
+     * words they hold in the lexicon, what those score and how long
+     * the longest is, into report.
+     *
+     * The boards are split over several threads, each rolling from
+     * generators seeded per block of boards and solving the way a
+     * single-threaded getAllValidWords() does, into histograms of
+     * its own; the board set by setBoard() is left alone. Returns
+     * false, sampling nothing, if there is no lexicon, if the dice
+     * fail validDice() or if the board has no cells.
+     */
+    bool sampleBoards(const SampleSettings& settings, SampleReport* report);
+
     /**
      * Checks whether a specified word is in the lexicon.
      *
@@ -80,6 +339,17 @@ public:
      */
     bool isInLexicon(const string& word_to_check);
 
+    /**
+     * Checks which of the specified words are in the lexicon.
+     *
+     * Takes an array of words and sets (*hits)[i] to whether
+     * words[i] is in the lexicon. Much faster per word than
+     * calling isInLexicon() in a loop, since lookups are advanced
+     * in lockstep and their memory accesses overlap.
+     */
+    void isInLexicon(const string* words, unsigned int count,
+                                          vector<bool>* hits);
+
     /**
      * Checks whether a specified word is on the board.
      *
@@ -89,6 +359,28 @@ public:
      */
     vector<int> isOnBoard(const string& word_to_check);
 
+    /**
+     * Checks whether a specified word is on the board, writing the
+     * path to a buffer instead of a new vector.
+     *
+     * path must have room for rows * cols cells. Returns the number
+     * of cells on the path, or 0 if the word is not on the board;
+     * the path is the one the vector overload returns. Makes no
+     * heap allocation.
+     */
+    unsigned int isOnBoard(const string& word_to_check, unsigned int* path);
+
+    /**
+     * Checks which of the specified words are on the board.
+     *
+     * Takes an array of words and sets (*paths)[i] to the path
+     * isOnBoard() returns for words[i]. The words are searched for
+     * together, in one pass over the board, so words sharing a
+     * prefix share the work of finding it.
+     */
+    void isOnBoard(const string* words, unsigned int count,
+                   vector< vector<int> >* paths);
+
     /**
      * Used for testing.
      */
@@ -0,0 +1,227 @@
+#include "bogglescan.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * ORs from, moved by shift cells towards higher indices, or lower
+ * ones if shift is negative, into to; bits are kept only where
+ * keep has them set, unless keep is null.
+ */
+static void shiftInto( const unsigned long long* from,
+                       unsigned long long* to,
+                       unsigned int words, int shift,
+                       const unsigned long long* keep ) {
+    unsigned int s = shift < 0 ? -shift : shift;
+    unsigned int q = s / 64, r = s % 64;
+
+    for ( unsigned int i = 0; i < words; i++ ) {
+        unsigned long long bits = 0;
+        if ( shift >= 0 ) {
+            if ( i >= q ) {
+                bits = from[i - q] << r;
+                if ( r != 0 && i > q ) bits |= from[i - q - 1] >> ( 64 - r );
+            }
+        }
+        else if ( i + q < words ) {
+            bits = from[i + q] >> r;
+            if ( r != 0 && i + q + 1 < words ) {
+                bits |= from[i + q + 1] << ( 64 - r );
+            }
+        }
+        to[i] |= keep == nullptr ? bits : bits & keep[i];
+    }
+}
+
+/**
+ * Constructs a BoardScan for a board, which must outlive it.
+ */
+BoardScan::BoardScan( const BoardGrid& grid )
+    : grid(grid), finder( grid ) {
+    reset();
+}
+
+/**
+ * Takes in the board as it is now, which may have been reassigned
+ * since the BoardScan was constructed.
+ */
+void BoardScan::reset() {
+    words = ( grid.size + 63 ) / 64;
+    longest = 0;
+    single.assign( 256, -1 );
+    multi.clear();
+    path.resize( grid.size );
+    faceBits.assign( grid.faces.size() * words, 0 );
+    blankBits.assign( words, 0 );
+    firstCol.assign( words, ~0ull );
+    lastCol.assign( words, ~0ull );
+    row.assign( words, 0 );
+
+    for ( unsigned int f = 0; f < grid.faces.size(); f++ ) {
+        // a blank face spells nothing; its cells are in blankBits
+        if ( grid.faces[f].length() == 1 ) {
+            single[ (unsigned char)grid.faces[f][0] ] = f;
+        }
+        else if ( grid.faces[f].length() > 1 ) {
+            multi.push_back( f );
+        }
+        if ( grid.faces[f].length() > longest ) {
+            longest = grid.faces[f].length();
+        }
+    }
+
+    // firstCol and lastCol are clear on the first and last column,
+    // where a sideways shift lands only by wrapping around a row
+    for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+        unsigned long long bit = 1ull << ( cell % 64 );
+        faceBits[ grid.face[cell] * words + cell / 64 ] |= bit;
+        if ( grid.faceAt( cell ).empty() ) {
+            blankBits[cell / 64] |= bit;
+        }
+        if ( cell % grid.cols == 0 ) {
+            firstCol[cell / 64] &= ~bit;
+        }
+        if ( cell % grid.cols == grid.cols - 1 ) {
+            lastCol[cell / 64] &= ~bit;
+        }
+    }
+}
+
+/**
+ * Sets to every cell in or next to a cell in from.
+ *
+ * The row neighbours are added first, then that set shifted a row
+ * up and down, four shifts in all. Keeping the cells of from lets
+ * a path step onto the cell it is on, which only makes the test
+ * weaker. Cells shifted past the end of the board are left in;
+ * they are masked off by the faces the result is combined with.
+ */
+void BoardScan::dilate( const unsigned long long* from,
+                        unsigned long long* to ) {
+    int cols = grid.cols;
+
+    // boards of at most 64 cells shift as plain words
+    if ( words == 1 && cols < 64 ) {
+        unsigned long long b = from[0];
+        b |= ( b << 1 & firstCol[0] ) | ( b >> 1 & lastCol[0] );
+        to[0] = b | b << cols | b >> cols;
+        return;
+    }
+
+    std::copy( from, from + words, row.begin() );
+    shiftInto( from, &row[0], words, 1, &firstCol[0] );
+    shiftInto( from, &row[0], words, -1, &lastCol[0] );
+    std::copy( row.begin(), row.end(), to );
+    shiftInto( &row[0], to, words, cols, nullptr );
+    shiftInto( &row[0], to, words, -cols, nullptr );
+}
+
+/**
+ * Judges whether some path, not necessarily simple, spells the
+ * specified characters.
+ */
+bool BoardScan::reachable( const char* word, unsigned int length ) {
+    unsigned int live = 0;
+
+    if ( length == 0 ) return 0;
+
+    // reach[p] holds the cells where a path spelling the first p
+    // characters ends, near[p] the cells next to them
+    if ( reach.size() < ( length + 1 ) * words ) {
+        reach.resize( ( length + 1 ) * words );
+        near.resize( ( length + 1 ) * words );
+    }
+
+    for ( unsigned int p = 1; p <= length; p++ ) {
+        unsigned long long* r = &reach[p * words];
+        unsigned long long any = 0;
+        int f = single[ (unsigned char)word[p-1] ];
+
+        std::fill( r, r + words, 0 );
+        if ( f >= 0 ) {
+            const unsigned long long* bits = &faceBits[f * words];
+            const unsigned long long* from = &near[ ( p - 1 ) * words ];
+            for ( unsigned int i = 0; i < words; i++ ) {
+                r[i] |= p == 1 ? bits[i] : bits[i] & from[i];
+            }
+        }
+        for ( unsigned int k = 0; k < multi.size(); k++ ) {
+            const string& face = grid.faces[ multi[k] ];
+            unsigned int n = face.length();
+            if ( n > p || memcmp( word + p - n, face.data(), n ) ) {
+                continue;
+            }
+            const unsigned long long* bits = &faceBits[ multi[k] * words ];
+            const unsigned long long* from = &near[ ( p - n ) * words ];
+            for ( unsigned int i = 0; i < words; i++ ) {
+                r[i] |= p == n ? bits[i] : bits[i] & from[i];
+            }
+        }
+
+        // paths may go on through blank cells without spelling more
+        for ( bool grown = grid.blanks != 0; grown; ) {
+            unsigned long long* next = &near[p * words];
+            dilate( r, next );
+            grown = 0;
+            for ( unsigned int i = 0; i < words; i++ ) {
+                unsigned long long add = next[i] & blankBits[i] & ~r[i];
+                if ( add != 0 ) grown = 1;
+                r[i] |= add;
+            }
+        }
+
+        for ( unsigned int i = 0; i < words; i++ ) {
+            any |= r[i];
+        }
+        if ( any != 0 ) {
+            live = p;
+            if ( p < length ) dilate( r, &near[p * words] );
+        }
+        else {
+            std::fill( &near[p * words], &near[p * words] + words, 0 );
+            // no face is long enough to reach past the gap
+            if ( p - live >= longest ) return 0;
+        }
+    }
+    return live == length;
+}
+
+/**
+ * Passes the words of at least min letters among those of a
+ * filter to sink, with their paths, if they are on the board;
+ * letters is the signature of the board's dice.
+ */
+void BoardScan::scan( const LexiconFilter& filter,
+                      const LetterSignature& letters,
+                      unsigned int min, WordSink* sink ) {
+    unsigned int cells;
+
+    if ( grid.size == 0 ) return;
+
+    // words needing a letter the dice lack are dropped first
+    filter.select( letters, filter.size(), selected );
+
+    for ( unsigned int i = 0; i < selected.size(); i++ ) {
+        const WordRef& w = selected[i];
+        if ( w.length < min || !reachable( w.data, w.length ) ) {
+            continue;
+        }
+        cells = finder.find( w.data, w.length, path.data() );
+        if ( cells != 0 ) {
+            sink->word( w.data, w.length, path.data(), cells );
+        }
+    }
+}
+
+/**
+ * Judges whether testing the words of a lexicon against a board
+ * should beat walking the board, for a board of cells cells and a
+ * lexicon of count words.
+ */
+bool preferScan( unsigned int cells, unsigned int count ) {
+    // fitted to bogbench strategy: the walk's cost grows with the
+    // prefixes a board keeps alive, which rises about as fast as
+    // cells squared until most short prefixes are alive anyway
+    unsigned long long limit = 37500000ull / ( (unsigned long long)cells * cells + 1 );
+    return count < std::max( limit, 2000ull );
+}
@@ -0,0 +1,121 @@
+#ifndef BOGGLESCAN_H
+#define BOGGLESCAN_H
+
+#include <vector>
+#include <string>
+
+#include "boggleutil.h"
+#include "bogglefilter.h"
+#include "bogglegrid.h"
+
+using std::vector;
+using std::string;
+
+/**
+ * Selects how getAllValidWords() finds the words on a board.
+ *
+ * BOARD_STRATEGY walks the board, following the lexicon from each
+ * path; LEXICON_STRATEGY tests every word of the lexicon against
+ * the board; AUTO_STRATEGY picks whichever a cost model expects to
+ * be cheaper.
+ */
+enum SolveStrategy {
+    AUTO_STRATEGY,
+    BOARD_STRATEGY,
+    LEXICON_STRATEGY
+};
+
+/**
+ * Tests the words of a lexicon against a BoardGrid, all cells of
+ * the board at once.
+ *
+ * The cells are bits of a bitboard, in words of 64. Following a
+ * word one face at a time, the cells at which some path spelling
+ * its first p characters can end are the neighbours of the cells
+ * for the shorter prefix, which four shifts compute for all cells
+ * together, masked with the cells showing the next face. Those
+ * paths may visit a cell twice, so a word whose last set is
+ * not empty is confirmed with a PathFinder, which also gives the
+ * path; almost every word dies after a step or two without one.
+ * Blank faces spell nothing, so every set also takes in the blank
+ * cells reachable from it.
+ *
+ * The test is scalar and bit-parallel, not vectorized: each step
+ * is plain 64-bit shifts, ANDs and ORs, one word of the bitboard
+ * at a time, so a word of 64 cells moves per operation. A face is
+ * matched by a table from its character to its id, or by memcmp()
+ * for a face of several characters, never by comparing face ids
+ * in vector registers. Only the LexiconFilter select which picks
+ * the words to test uses SSE2.
+ */
+class BoardScan {
+
+private:
+    const BoardGrid& grid;
+    unsigned int words;
+    unsigned int longest;
+    vector<unsigned long long> faceBits;
+    vector<unsigned long long> blankBits;
+    vector<int> single;
+    vector<unsigned int> multi;
+    vector<unsigned long long> firstCol;
+    vector<unsigned long long> lastCol;
+    vector<unsigned long long> reach;
+    vector<unsigned long long> near;
+    vector<unsigned long long> row;
+    PathFinder finder;
+    vector<unsigned int> path;
+    vector<WordRef> selected;
+
+    /**
+     * Sets to every cell in or next to a cell in from.
+     */
+    void dilate(const unsigned long long* from, unsigned long long* to);
+
+    /**
+     * Judges whether some path, not necessarily simple, spells the
+     * specified characters.
+     */
+    bool reachable(const char* word, unsigned int length);
+
+public:
+    /**
+     * Constructs a BoardScan for a board, which must outlive it.
+     */
+    BoardScan(const BoardGrid& grid);
+
+    /**
+     * Takes in the board as it is now, which may have been
+     * reassigned since the BoardScan was constructed, keeping the
+     * capacity of every buffer.
+     */
+    void reset();
+
+    /**
+     * Passes the words of at least min letters among those of a
+     * filter to sink, with their paths, if they are on the board;
+     * letters is the signature of the board's dice.
+     */
+    void scan(const LexiconFilter& filter, const LetterSignature& letters,
+              unsigned int min, WordSink* sink);
+
+};
+
+/**
+ * Judges whether testing the words of a lexicon against a board
+ * should beat walking the board, for a board of cells cells and a
+ * lexicon of count words.
+ *
+ * The crossover runs the other way from what one might expect:
+ * measured with bogbench strategy, the scan does not win on large
+ * boards. A large, dense board keeps nearly every short prefix
+ * alive, so the walk's cost levels off, while the scan's grows
+ * with the board and the letter filter prunes little. The scan
+ * wins for small lexicons on any board, and for mid-sized ones
+ * only on small boards, so it is preferred below
+ * max(2000, 37.5M / cells^2) words: under about 146k words on a
+ * 4x4 board, 9k on 8x8 and the 2000 floor from 12x12 up.
+ */
+bool preferScan(unsigned int cells, unsigned int count);
+
+#endif // BOGGLESCAN_H
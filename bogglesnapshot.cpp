@@ -0,0 +1,136 @@
+#include "bogglesnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MAGIC[8] = { 'B', 'O', 'G', 'L', 'E', 'X', 'S', 0 };
+static const unsigned int VERSION = 1;
+static const unsigned int BYTE_ORDER_MARK = 0x01020304;
+
+/**
+ * Destructs a LexiconSnapshot, unmapping its file.
+ */
+LexiconSnapshot::~LexiconSnapshot() {
+    close();
+}
+
+/**
+ * Maps a snapshot file and checks its header.
+ *
+ * Returns false if the file cannot be mapped, or was written
+ * by another version or host; nothing is mapped then. Pages
+ * are read lazily, on first access.
+ */
+bool LexiconSnapshot::open( const char* path ) {
+    struct stat st;
+    const SnapshotHeader *h;
+    void *p;
+    int fd;
+
+    close();
+
+    fd = ::open( path, O_RDONLY );
+    if ( fd < 0 ) return 0;
+
+    if ( fstat( fd, &st ) != 0
+           || (size_t)st.st_size < sizeof( SnapshotHeader ) ) {
+        ::close( fd );
+        return 0;
+    }
+
+    p = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if ( p == MAP_FAILED ) return 0;
+
+    map = (const char*)p;
+    length = st.st_size;
+
+    h = header();
+    if ( memcmp( h->magic, MAGIC, sizeof( MAGIC ) ) != 0
+           || h->version != VERSION
+           || h->byteOrder != BYTE_ORDER_MARK
+           || h->entrySize == 0
+           || ( length - sizeof( SnapshotHeader ) ) / h->entrySize
+                                                   < h->count ) {
+        close();
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Unmaps the file, if any.
+ */
+void LexiconSnapshot::close() {
+    if ( map != nullptr ) {
+        munmap( (void*)map, length );
+        map = nullptr;
+        length = 0;
+    }
+}
+
+/**
+ * Exchanges mappings with another LexiconSnapshot.
+ */
+void LexiconSnapshot::swap( LexiconSnapshot& other ) {
+    const char *m = map;
+    size_t l = length;
+    map = other.map;
+    length = other.length;
+    other.map = m;
+    other.length = l;
+}
+
+/**
+ * Returns the header, or nullptr if nothing is mapped.
+ */
+const SnapshotHeader* LexiconSnapshot::header() {
+    return (const SnapshotHeader*)map;
+}
+
+/**
+ * Returns the first entry after the header.
+ */
+const void* LexiconSnapshot::entries() {
+    return map + sizeof( SnapshotHeader );
+}
+
+/**
+ * Writes a snapshot file.
+ *
+ * Returns false if the file cannot be written.
+ */
+bool LexiconSnapshot::write( const char* path,
+                             unsigned int type,
+                             unsigned int root,
+                             const void* entries,
+                             unsigned int count,
+                             unsigned int entrySize ) {
+    SnapshotHeader h;
+    FILE *f;
+    bool ok;
+
+    memset( &h, 0, sizeof( h ) );
+    memcpy( h.magic, MAGIC, sizeof( MAGIC ) );
+    h.version = VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.type = type;
+    h.root = root;
+    h.count = count;
+    h.entrySize = entrySize;
+
+    f = fopen( path, "wb" );
+    if ( f == nullptr ) return 0;
+
+    ok = fwrite( &h, sizeof( h ), 1, f ) == 1;
+    if ( ok && count > 0 ) {
+        ok = fwrite( entries, entrySize, count, f ) == count;
+    }
+
+    return fclose( f ) == 0 && ok;
+}
@@ -0,0 +1,87 @@
+#ifndef BOGGLESNAPSHOT_H
+#define BOGGLESNAPSHOT_H
+
+#include <cstddef>
+
+/**
+ * Header at the start of a lexicon snapshot file.
+ *
+ * It is followed directly by count entries of entrySize bytes:
+ * the TST's nodes or the DAWG's packed edges, exactly as they sit
+ * in memory, so a mapped snapshot is queried in place. Snapshots
+ * are native-endian; byteOrder rejects files from other hosts.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int byteOrder;
+    unsigned int type;
+    unsigned int root;
+    unsigned int count;
+    unsigned int entrySize;
+};
+
+/**
+ * Represents a read-only mapping of a lexicon snapshot file.
+ */
+class LexiconSnapshot {
+
+private:
+    const char* map;
+    size_t length;
+
+    LexiconSnapshot(const LexiconSnapshot&);
+    LexiconSnapshot& operator=(const LexiconSnapshot&);
+
+public:
+    /**
+     * Constructs a LexiconSnapshot with nothing mapped.
+     */
+    LexiconSnapshot() : map(nullptr), length(0) {}
+
+    /**
+     * Destructs a LexiconSnapshot, unmapping its file.
+     */
+    ~LexiconSnapshot();
+
+    /**
+     * Maps a snapshot file and checks its header.
+     *
+     * Returns false if the file cannot be mapped, or was written
+     * by another version or host; nothing is mapped then. Pages
+     * are read lazily, on first access.
+     */
+    bool open(const char* path);
+
+    /**
+     * Unmaps the file, if any.
+     */
+    void close();
+
+    /**
+     * Exchanges mappings with another LexiconSnapshot.
+     */
+    void swap(LexiconSnapshot& other);
+
+    /**
+     * Returns the header, or nullptr if nothing is mapped.
+     */
+    const SnapshotHeader* header();
+
+    /**
+     * Returns the first entry after the header.
+     */
+    const void* entries();
+
+    /**
+     * Writes a snapshot file.
+     *
+     * Returns false if the file cannot be written.
+     */
+    static bool write(const char* path, unsigned int type,
+                      unsigned int root, const void* entries,
+                      unsigned int count, unsigned int entrySize);
+
+};
+
+#endif // BOGGLESNAPSHOT_H
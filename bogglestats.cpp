@@ -0,0 +1,396 @@
+#include "bogglestats.h"
+#include "bogglebatch.h"
+#include "boggledawg.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// boards rolled from one generator, and handed out together
+static const unsigned int BLOCK_SAMPLES = 4096;
+
+/**
+ * Adds the counts of another Histogram.
+ */
+void Histogram::merge( const Histogram& other ) {
+    if ( other.counts.size() > counts.size() ) {
+        counts.resize( other.counts.size(), 0 );
+    }
+    for ( unsigned int v = 0; v < other.counts.size(); v++ ) {
+        counts[v] += other.counts[v];
+    }
+    total += other.total;
+    sum += other.sum;
+    squares += other.squares;
+}
+
+/**
+ * Removes every value, keeping the capacity.
+ */
+void Histogram::clear() {
+    counts.clear();
+    total = 0;
+    sum = 0;
+    squares = 0;
+}
+
+/**
+ * Returns the smallest value counted, or 0 if there is none.
+ */
+unsigned int Histogram::smallest() const {
+    for ( unsigned int v = 0; v < counts.size(); v++ ) {
+        if ( counts[v] != 0 ) return v;
+    }
+    return 0;
+}
+
+/**
+ * Returns the largest value counted, or 0 if there is none.
+ */
+unsigned int Histogram::largest() const {
+    // add() only grows counts for a value it counts
+    return counts.empty() ? 0 : counts.size() - 1;
+}
+
+/**
+ * Returns the mean of the values, or 0 if there are none.
+ */
+double Histogram::mean() const {
+    return total == 0 ? 0 : (double)sum / total;
+}
+
+/**
+ * Returns the standard deviation of the values, or 0 if there are
+ * none.
+ */
+double Histogram::deviation() const {
+    double m = mean();
+
+    if ( total == 0 ) return 0;
+    return std::sqrt( std::max( (double)squares / total - m * m, 0.0 ) );
+}
+
+/**
+ * Returns the smallest value at or above which no more than
+ * 1 - fraction of the values lie, or 0 if there are none.
+ */
+unsigned int Histogram::percentile( double fraction ) const {
+    unsigned long long seen = 0;
+
+    for ( unsigned int v = 0; v < counts.size(); v++ ) {
+        seen += counts[v];
+        if ( seen != 0 && seen >= fraction * total ) return v;
+    }
+    return largest();
+}
+
+/**
+ * A xoshiro256** generator, seeded through splitmix64 from a seed
+ * and the number of a stream, so every block of boards has a
+ * stream of its own that any thread can roll it from.
+ */
+class SampleRandom {
+
+private:
+    unsigned long long s[4];
+
+    static unsigned long long rotate( unsigned long long x, int k ) {
+        return ( x << k ) | ( x >> ( 64 - k ) );
+    }
+
+    /**
+     * Advances a splitmix64 state and returns its next output.
+     */
+    static unsigned long long split( unsigned long long& x ) {
+        unsigned long long z = ( x += 0x9e3779b97f4a7c15ull );
+        z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+        z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebull;
+        return z ^ ( z >> 31 );
+    }
+
+public:
+    SampleRandom( unsigned long long seed, unsigned long long stream ) {
+        unsigned long long x = seed;
+
+        x = split( x ) ^ stream;
+        for ( int k = 0; k < 4; k++ ) {
+            s[k] = split( x );
+        }
+    }
+
+    unsigned long long next() {
+        unsigned long long result = rotate( s[1] * 5, 7 ) * 9;
+        unsigned long long t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotate( s[3], 45 );
+        return result;
+    }
+
+    /**
+     * Returns a number below n, from the top 32 bits of the next
+     * output; the bias, n in 2^32, is far below what sampling sees.
+     */
+    unsigned int below( unsigned int n ) {
+        return (unsigned int)( ( ( next() >> 32 ) * n ) >> 32 );
+    }
+
+};
+
+/**
+ * Counts the words of a board, their score and the length of the
+ * longest.
+ */
+class SampleSink : public WordSink {
+
+public:
+    unsigned int count;
+    unsigned int score;
+    unsigned int longest;
+
+    SampleSink() : count(0), score(0), longest(0) {}
+
+    void word( const char* data, unsigned int length,
+               const unsigned int* path, unsigned int cells ) {
+        count++;
+        score += scoreWord( length );
+        if ( length > longest ) longest = length;
+    }
+
+};
+
+/**
+ * The board, search and histograms of one thread of
+ * sampleBoards().
+ *
+ * The faces of every die are packed once, as BoardGrid::assign()
+ * takes them, side after side; rolling a board copies the bytes of
+ * the face each die shows into one buffer, which keeps its
+ * capacity from board to board.
+ */
+template<class L>
+class SampleWorker {
+
+private:
+    const SampleSettings& settings;
+    const DiceFaces& dice;
+    BoardGrid grid;
+    SampleSink sink;
+    SearchSet<L> searches;
+    vector<unsigned char> bytes;
+    vector<unsigned int> sideStart;
+    vector<unsigned int> dieStart;
+    vector<unsigned int> die;
+    vector<unsigned char> packed;
+
+    /**
+     * Rolls a board with a generator into packed.
+     */
+    void roll( SampleRandom& rng ) {
+        unsigned int n = die.size();
+
+        if ( settings.shuffle ) {
+            for ( unsigned int cell = n - 1; cell > 0; cell-- ) {
+                std::swap( die[cell], die[ rng.below( cell + 1 ) ] );
+            }
+        }
+        packed.clear();
+        for ( unsigned int cell = 0; cell < n; cell++ ) {
+            unsigned int d = die[cell];
+            unsigned int s = dieStart[d]
+                           + rng.below( dieStart[d+1] - dieStart[d] );
+            packed.insert( packed.end(), &bytes[ sideStart[s] ],
+                           &bytes[0] + sideStart[s+1] );
+        }
+    }
+
+public:
+    Histogram words;
+    Histogram scores;
+    Histogram longest;
+
+    SampleWorker( const L& lex, const DiceFaces& dice,
+                  const SampleSettings& settings )
+        : settings(settings), dice(dice),
+          searches( grid, lex, settings.min, &sink ) {
+        unsigned int n = settings.rows * settings.cols;
+
+        for ( unsigned int d = 0; d < dice.size(); d++ ) {
+            dieStart.push_back( sideStart.size() );
+            for ( unsigned int s = 0; s < dice[d].size(); s++ ) {
+                sideStart.push_back( bytes.size() );
+                bytes.push_back( dice[d][s].length() );
+                bytes.insert( bytes.end(), dice[d][s].begin(),
+                              dice[d][s].end() );
+            }
+        }
+        dieStart.push_back( sideStart.size() );
+        sideStart.push_back( bytes.size() );
+
+        die.resize( n );
+        for ( unsigned int cell = 0; cell < n; cell++ ) {
+            die[cell] = cell % dice.size();
+        }
+    }
+
+    /**
+     * Rolls, solves and counts the boards of a block.
+     */
+    void sample( unsigned long long block ) {
+        SampleRandom rng( settings.seed, block );
+        unsigned long long first = block * BLOCK_SAMPLES;
+        unsigned long long last = std::min( settings.samples,
+                                            first + BLOCK_SAMPLES );
+
+        // a block starts from the dice in order, whoever rolled last
+        if ( settings.shuffle ) {
+            for ( unsigned int cell = 0; cell < die.size(); cell++ ) {
+                die[cell] = cell % dice.size();
+            }
+        }
+
+        for ( unsigned long long b = first; b < last; b++ ) {
+            roll( rng );
+            grid.assign( settings.rows, settings.cols, packed.data() );
+            sink.count = 0;
+            sink.score = 0;
+            sink.longest = 0;
+            searches.search();
+            words.add( sink.count );
+            scores.add( sink.score );
+            longest.add( sink.longest );
+        }
+    }
+
+};
+
+/**
+ * Rolls random boards from a set of dice and gathers the
+ * distributions of their words in a lexicon into report.
+ *
+ * Each thread keeps its own worker, and merges its histograms into
+ * the report under a lock once the blocks run out; the counts are
+ * sums, so the order of the merges does not matter.
+ */
+template<class L>
+void sampleBoards( const L& lex, const SampleSettings& settings,
+                   SampleReport* report ) {
+    typedef std::chrono::steady_clock Clock;
+    DiceFaces standard;
+    const DiceFaces* dice = &settings.dice;
+    unsigned int threads = settings.threads;
+    unsigned long long blocks;
+    std::atomic<unsigned long long> next( 0 );
+    std::mutex merging;
+    vector<std::thread> pool;
+    Clock::time_point start = Clock::now();
+
+    report->samples = 0;
+    report->seconds = 0;
+    report->words.clear();
+    report->scores.clear();
+    report->longest.clear();
+
+    if ( !validDice( *dice ) || settings.rows == 0 || settings.cols == 0
+         || settings.samples == 0 ) {
+        return;
+    }
+    if ( dice->empty() ) {
+        standard = standardDice();
+        dice = &standard;
+    }
+
+    blocks = ( settings.samples + BLOCK_SAMPLES - 1 ) / BLOCK_SAMPLES;
+    if ( threads == 0 ) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if ( threads == 0 ) {
+        threads = 1;
+    }
+    if ( threads > blocks ) {
+        threads = blocks;
+    }
+
+    auto work = [&]() {
+        SampleWorker<L> worker( lex, *dice, settings );
+        unsigned long long b;
+        while ( ( b = next++ ) < blocks ) {
+            worker.sample( b );
+        }
+        std::lock_guard<std::mutex> lock( merging );
+        report->words.merge( worker.words );
+        report->scores.merge( worker.scores );
+        report->longest.merge( worker.longest );
+    };
+
+    for ( unsigned int t = 1; t < threads; t++ ) {
+        pool.push_back( std::thread( work ) );
+    }
+    work();
+    for ( unsigned int t = 0; t < pool.size(); t++ ) {
+        pool[t].join();
+    }
+
+    report->samples = report->words.samples();
+    report->seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+}
+
+template void sampleBoards<TST>( const TST&, const SampleSettings&,
+                                 SampleReport* );
+template void sampleBoards<DAWG>( const DAWG&, const SampleSettings&,
+                                  SampleReport* );
+
+/**
+ * Writes one line of the summary, for the histogram of one
+ * measure.
+ */
+static void writeMeasure( std::ostream& out, const char* name,
+                          const Histogram& h ) {
+    char line[160];
+
+    snprintf( line, sizeof line,
+              "%-8s %9.2f %9.2f %6u %6u %6u %6u %6u %6u %6u\n", name,
+              h.mean(), h.deviation(), h.smallest(), h.percentile( 0.01 ),
+              h.percentile( 0.1 ), h.percentile( 0.5 ), h.percentile( 0.9 ),
+              h.percentile( 0.99 ), h.largest() );
+    out << line;
+}
+
+/**
+ * Writes a summary of a report to out.
+ */
+void writeSampleReport( std::ostream& out, const SampleReport& report ) {
+    char line[160];
+
+    snprintf( line, sizeof line, "%llu boards in %.2f s (%.0f boards/s)\n",
+              report.samples, report.seconds,
+              report.seconds > 0 ? report.samples / report.seconds : 0.0 );
+    out << line;
+    if ( report.samples == 0 ) return;
+
+    snprintf( line, sizeof line,
+              "%-8s %9s %9s %6s %6s %6s %6s %6s %6s %6s\n", "",
+              "mean", "stdev", "min", "p1", "p10", "p50", "p90", "p99",
+              "max" );
+    out << line;
+    writeMeasure( out, "words", report.words );
+    writeMeasure( out, "score", report.scores );
+    writeMeasure( out, "longest", report.longest );
+
+    out << "longest word\n";
+    for ( unsigned int v = 0; v < report.longest.size(); v++ ) {
+        if ( report.longest.count( v ) == 0 ) continue;
+        snprintf( line, sizeof line, "%6u letters %12llu %8.4f%%\n", v,
+                  report.longest.count( v ),
+                  100.0 * report.longest.count( v ) / report.samples );
+        out << line;
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef BOGGLESTATS_H
+#define BOGGLESTATS_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+#include "boggleutil.h"
+#include "bogglegrid.h"
+#include "boggleanneal.h"
+
+using std::vector;
+using std::string;
+
+/**
+ * Counts how often each value up to some largest value occurs,
+ * one counter per value, with the sums of the values and their
+ * squares.
+ *
+ * Adding a value is an increment, and the counter array only grows
+ * when a value larger than any before arrives, so a Histogram takes
+ * millions of values without keeping them. Histograms fed parts of
+ * the same values merge into the one fed all of them.
+ */
+class Histogram {
+
+private:
+    vector<unsigned long long> counts;
+    unsigned long long total;
+    unsigned long long sum;
+    unsigned long long squares;
+
+public:
+    /**
+     * Constructs an empty Histogram.
+     */
+    Histogram() : total(0), sum(0), squares(0) {}
+
+    /**
+     * Counts one occurrence of a value.
+     */
+    void add(unsigned int value) {
+        if ( value >= counts.size() ) counts.resize( value + 1, 0 );
+        counts[value]++;
+        total++;
+        sum += value;
+        squares += (unsigned long long)value * value;
+    }
+
+    /**
+     * Adds the counts of another Histogram.
+     */
+    void merge(const Histogram& other);
+
+    /**
+     * Removes every value, keeping the capacity.
+     */
+    void clear();
+
+    /**
+     * Returns the number of values counted.
+     */
+    unsigned long long samples() const { return total; }
+
+    /**
+     * Returns how often a value occurred.
+     */
+    unsigned long long count(unsigned int value) const {
+        return value < counts.size() ? counts[value] : 0;
+    }
+
+    /**
+     * Returns one more than the largest value counted, or 0 if
+     * there is none.
+     */
+    unsigned int size() const { return counts.size(); }
+
+    /**
+     * Returns the smallest value counted, or 0 if there is none.
+     */
+    unsigned int smallest() const;
+
+    /**
+     * Returns the largest value counted, or 0 if there is none.
+     */
+    unsigned int largest() const;
+
+    /**
+     * Returns the mean of the values, or 0 if there are none.
+     */
+    double mean() const;
+
+    /**
+     * Returns the standard deviation of the values, or 0 if there
+     * are none.
+     */
+    double deviation() const;
+
+    /**
+     * Returns the smallest value at or above which no more than
+     * 1 - fraction of the values lie, or 0 if there are none;
+     * percentile(0.5) is the median.
+     */
+    unsigned int percentile(double fraction) const;
+
+};
+
+/**
+ * Settings of sampleBoards().
+ *
+ * samples boards of rows rows and cols columns are rolled from
+ * dice, or from standardDice() if it is empty, and solved for the
+ * words of at least min letters, on threads threads, or one per
+ * hardware thread if 0. Cell i gets die i modulo the number of
+ * dice, as BoggleBoard::initRandomBoard() rolls them, unless
+ * shuffle is set, when the dice are shuffled over the cells first,
+ * as a shaken board has them. The boards follow from seed alone.
+ */
+struct SampleSettings {
+    DiceFaces dice;
+    unsigned int rows;
+    unsigned int cols;
+    unsigned int min;
+    unsigned long long samples;
+    unsigned int threads;
+    bool shuffle;
+    unsigned long long seed;
+
+    /**
+     * Constructs the settings of a million 4x4 boards, rolled as
+     * initRandomBoard() rolls them, of words of at least 3 letters,
+     * with one thread per hardware thread.
+     */
+    SampleSettings()
+        : rows(4), cols(4), min(3), samples(1000000), threads(0),
+          shuffle(0), seed(1) {}
+};
+
+/**
+ * What sampleBoards() found over its boards: how many words each
+ * board held, what they scored under the standard rules, and how
+ * many letters the longest of them had, 0 for a board with none,
+ * with the number of boards and the seconds they took.
+ */
+struct SampleReport {
+    unsigned long long samples;
+    double seconds;
+    Histogram words;
+    Histogram scores;
+    Histogram longest;
+};
+
+/**
+ * Rolls random boards from a set of dice and gathers the
+ * distributions of their words in a lexicon into report.
+ *
+ * L is TST or DAWG. The boards are split into blocks of
+ * consecutive boards, handed out through one counter; block b is
+ * rolled by a generator seeded with settings.seed and b, so the
+ * report does not depend on the number of threads. Each thread
+ * rolls its boards into one packed buffer, assigns them to one
+ * BoardGrid, solves them through one SearchSet and counts them in
+ * histograms of its own, merged once it is done, so once its
+ * buffers have grown to fit, a board allocates nothing. The report
+ * is left empty if the dice fail validDice() or there is no board
+ * to roll.
+ */
+template<class L>
+void sampleBoards(const L& lex, const SampleSettings& settings,
+                  SampleReport* report);
+
+/**
+ * Writes a summary of a report to out: the boards per second, and
+ * for the words, scores and longest words their mean, standard
+ * deviation, smallest and largest values and percentiles, followed
+ * by the share of the boards whose longest word has each length.
+ */
+void writeSampleReport(std::ostream& out, const SampleReport& report);
+
+#endif // BOGGLESTATS_H
@@ -0,0 +1,247 @@
+#include "boggletree.h"
+#include "boggledawg.h"
+
+#include <algorithm>
+
+const unsigned int SearchTree::NONE;
+
+/**
+ * Constructs an empty SearchTree for a board, which must outlive
+ * it.
+ */
+SearchTree::SearchTree( const BoardGrid& grid )
+    : grid(grid), live(0), finder(grid) {}
+
+/**
+ * Removes every node and word.
+ */
+void SearchTree::clear() {
+    nodes.clear();
+    live = 0;
+    words.clear();
+    counts.clear();
+    best.clear();
+}
+
+/**
+ * Writes the cells of the path of a node to cells, and returns how
+ * many there are.
+ */
+unsigned int SearchTree::pathOf( unsigned int node,
+                                 unsigned int* cells ) const {
+    unsigned int n = 0;
+
+    for ( ; node != NONE; node = nodes[node].parent ) {
+        cells[n++] = nodes[node].cell;
+    }
+    std::reverse( cells, cells + n );
+    return n;
+}
+
+/**
+ * Judges whether the path of node a comes before that of b.
+ */
+bool SearchTree::before( unsigned int a, unsigned int b ) {
+    unsigned int na = pathOf( a, path.data() );
+    unsigned int nb = pathOf( b, other.data() );
+
+    return std::lexicographical_compare( path.begin(), path.begin() + na,
+                                         other.begin(), other.begin() + nb );
+}
+
+/**
+ * Counts a new node towards the word it spells, which is str.
+ */
+void SearchTree::note( unsigned int node ) {
+    int w = words.find( str.data(), str.length() );
+
+    if ( w < 0 ) {
+        words.insert( str.data(), str.length() );
+        w = words.size() - 1;
+        counts.push_back( 0 );
+        best.push_back( NONE );
+    }
+    nodes[node].word = w;
+
+    // NONE with a count left means the best path died; report()
+    // asks the PathFinder then
+    if ( counts[w]++ == 0 ) {
+        best[w] = node;
+    }
+    else if ( best[w] != NONE && before( node, best[w] ) ) {
+        best[w] = node;
+    }
+}
+
+/**
+ * Drops the dead nodes and the words no live node spells,
+ * renumbering the rest in order.
+ */
+void SearchTree::compact() {
+    unsigned int k = 0;
+
+    // a live node's parent is live, and comes before it
+    remap.resize( nodes.size() );
+    for ( unsigned int i = 0; i < nodes.size(); i++ ) {
+        if ( !nodes[i].live ) continue;
+        remap[i] = k;
+        nodes[k] = nodes[i];
+        if ( nodes[k].parent != NONE ) {
+            nodes[k].parent = remap[ nodes[k].parent ];
+        }
+        k++;
+    }
+    nodes.resize( k );
+
+    // the words move to the spare set, which keeps its capacity
+    words.swap( spare );
+    words.clear();
+    wordMap.resize( spare.size() );
+    for ( unsigned int w = 0, n = 0; w < spare.size(); w++ ) {
+        if ( counts[w] == 0 ) continue;
+        words.insert( spare.data( w ), spare.length( w ) );
+        counts[n] = counts[w];
+        best[n] = best[w] != NONE ? remap[ best[w] ] : NONE;
+        wordMap[w] = n++;
+    }
+    counts.resize( words.size() );
+    best.resize( words.size() );
+    for ( unsigned int i = 0; i < nodes.size(); i++ ) {
+        if ( nodes[i].word >= 0 ) {
+            nodes[i].word = wordMap[ nodes[i].word ];
+        }
+    }
+}
+
+/**
+ * Adds a node for the path of a parent node extended by a cell,
+ * and the nodes below it, if the lexicon holds a prefix for it.
+ */
+template<class L>
+void SearchTree::grow( const L& lex, unsigned int cell, unsigned int parent,
+                       LexiconCursor cursor, unsigned long long visited ) {
+    const string& f = grid.faceAt( cell );
+    unsigned long long next;
+    unsigned int node;
+
+    if ( !lex.advance( cursor, f.data(), f.length() ) ) {
+        return;
+    }
+
+    str.append( f );
+    visited |= 1ull << cell;
+    node = nodes.size();
+    TreeNode n = { parent, cell, -1, 1, cursor, visited };
+    nodes.push_back( n );
+    live++;
+
+    if ( cursor.end ) {
+        note( node );
+    }
+
+    for ( next = grid.adjMask[cell] & ~visited; next != 0;
+                                           next &= next - 1 ) {
+        grow( lex, __builtin_ctzll( next ), node, cursor, visited );
+    }
+
+    str.resize( str.length() - f.length() );
+}
+
+/**
+ * Replaces the tree with every path on the board which a lexicon
+ * holds a prefix for.
+ */
+template<class L>
+void SearchTree::build( const L& lex ) {
+    clear();
+    if ( grid.size > BoardGrid::MASK_CELLS ) return;
+
+    path.resize( grid.size );
+    other.resize( grid.size );
+    str.clear();
+    for ( unsigned int cell = 0; cell < grid.size; cell++ ) {
+        grow( lex, cell, NONE, LexiconCursor(), 0 );
+    }
+}
+
+/**
+ * Brings the tree up to date after the face of a cell changed,
+ * with the lexicon it was built from.
+ *
+ * Once more nodes have died than live, the dead ones are dropped.
+ */
+template<class L>
+void SearchTree::update( const L& lex, unsigned int cell ) {
+    const string& face = grid.faceAt( cell );
+    unsigned long long bit = 1ull << cell;
+    unsigned int old = nodes.size(), grown;
+
+    // every path through the cell spells something else now
+    for ( unsigned int i = 0; i < old; i++ ) {
+        TreeNode& n = nodes[i];
+        if ( !n.live || !( n.visited & bit ) ) continue;
+        n.live = 0;
+        live--;
+        if ( n.word >= 0 ) {
+            counts[n.word]--;
+            if ( best[n.word] == i ) best[n.word] = NONE;
+        }
+    }
+
+    if ( old - live > live ) {
+        compact();
+    }
+
+    str.clear();
+    grown = nodes.size();
+    grow( lex, cell, NONE, LexiconCursor(), 0 );
+
+    // paths entering the cell extend live paths next to it, which
+    // do not run through it and so have not changed
+    for ( unsigned int i = 0; i < grown; i++ ) {
+        if ( !nodes[i].live || ( nodes[i].visited & bit )
+               || !( grid.adjMask[ nodes[i].cell ] & bit ) ) {
+            continue;
+        }
+        LexiconCursor cursor = nodes[i].cursor, probe = cursor;
+        unsigned long long visited = nodes[i].visited;
+        unsigned int n;
+
+        // most paths cannot take the new face at all
+        if ( !lex.advance( probe, face.data(), face.length() ) ) {
+            continue;
+        }
+
+        n = pathOf( i, path.data() );
+        str.clear();
+        for ( unsigned int k = 0; k < n; k++ ) {
+            str.append( grid.faceAt( path[k] ) );
+        }
+        grow( lex, cell, i, cursor, visited );
+    }
+}
+
+/**
+ * Passes the words of at least min letters on the board to sink,
+ * each once, with the path a full search would give.
+ */
+void SearchTree::report( unsigned int min, WordSink* sink ) {
+    unsigned int cells;
+
+    for ( unsigned int w = 0; w < words.size(); w++ ) {
+        if ( counts[w] == 0 || words.length( w ) < min ) continue;
+        if ( best[w] != NONE ) {
+            cells = pathOf( best[w], path.data() );
+        }
+        else {
+            cells = finder.find( words.data( w ), words.length( w ),
+                                 path.data() );
+        }
+        sink->word( words.data( w ), words.length( w ), path.data(), cells );
+    }
+}
+
+template void SearchTree::build<TST>( const TST& );
+template void SearchTree::build<DAWG>( const DAWG& );
+template void SearchTree::update<TST>( const TST&, unsigned int );
+template void SearchTree::update<DAWG>( const DAWG&, unsigned int );
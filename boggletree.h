@@ -0,0 +1,137 @@
+#ifndef BOGGLETREE_H
+#define BOGGLETREE_H
+
+#include <vector>
+#include <string>
+
+#include "boggleutil.h"
+#include "bogglegrid.h"
+
+using std::vector;
+using std::string;
+
+/**
+ * Keeps every path a board search follows, so the words on the
+ * board can be brought up to date when a die changes by searching
+ * only the paths through it.
+ *
+ * The paths form a tree: a node is a path whose letters are a
+ * prefix in the lexicon, and its parent is the path one die
+ * shorter. Changing a die kills every node whose path runs through
+ * its cell; the paths into the cell then grow from the live nodes
+ * next to it, since no path avoiding the cell has changed. Every
+ * word counts the live nodes spelling it, so it is on the board
+ * while the count is not 0, and keeps the smallest of their paths,
+ * cell by cell, which is the path a full search meets first; a
+ * word whose path died gets it from a PathFinder instead. Only
+ * boards of at most 64 cells are kept, as the visited cells of a
+ * node are one mask.
+ */
+class SearchTree {
+
+private:
+    static const unsigned int NONE = 0xffffffff;
+
+    /**
+     * A path of the tree: its last cell, its parent, or NONE at a
+     * start cell, the lexicon after its letters, the cells on it
+     * and the word it spells, or -1.
+     */
+    struct TreeNode {
+        unsigned int parent;
+        unsigned int cell;
+        int word;
+        bool live;
+        LexiconCursor cursor;
+        unsigned long long visited;
+    };
+
+    const BoardGrid& grid;
+    vector<TreeNode> nodes;
+    unsigned int live;
+    WordSet words;
+    WordSet spare;
+    vector<unsigned int> counts;
+    vector<unsigned int> best;
+    PathFinder finder;
+    string str;
+    vector<unsigned int> path;
+    vector<unsigned int> other;
+    vector<unsigned int> remap;
+    vector<unsigned int> wordMap;
+
+    /**
+     * Adds a node for the path of a parent node extended by a
+     * cell, and the nodes below it, if the lexicon holds a prefix
+     * for it.
+     */
+    template<class L>
+    void grow(const L& lex, unsigned int cell, unsigned int parent,
+              LexiconCursor cursor, unsigned long long visited);
+
+    /**
+     * Counts a new node towards the word it spells, which is str.
+     */
+    void note(unsigned int node);
+
+    /**
+     * Drops the dead nodes and the words no live node spells,
+     * renumbering the rest in order.
+     */
+    void compact();
+
+    /**
+     * Writes the cells of the path of a node to cells, and returns
+     * how many there are.
+     */
+    unsigned int pathOf(unsigned int node, unsigned int* cells) const;
+
+    /**
+     * Judges whether the path of node a comes before that of b.
+     */
+    bool before(unsigned int a, unsigned int b);
+
+public:
+    /**
+     * Constructs an empty SearchTree for a board, which must
+     * outlive it.
+     */
+    SearchTree(const BoardGrid& grid);
+
+    /**
+     * Removes every node and word.
+     */
+    void clear();
+
+    /**
+     * Replaces the tree with every path on the board which a
+     * lexicon holds a prefix for.
+     *
+     * L is TST or DAWG.
+     */
+    template<class L>
+    void build(const L& lex);
+
+    /**
+     * Brings the tree up to date after the face of a cell changed,
+     * with the lexicon it was built from.
+     *
+     * Once more nodes have died than live, the dead ones are dropped.
+     */
+    template<class L>
+    void update(const L& lex, unsigned int cell);
+
+    /**
+     * Passes the words of at least min letters on the board to
+     * sink, each once, with the path a full search would give.
+     */
+    void report(unsigned int min, WordSink* sink);
+
+    /**
+     * Returns the number of live nodes.
+     */
+    unsigned int size() const { return live; }
+
+};
+
+#endif // BOGGLETREE_H
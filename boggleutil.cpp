@@ -1,146 +1,122 @@
 #include "boggleutil.h"
+#include "boggledawg.h"
 
-/**
- * Constructs a Node from the given parameters.
- */
-Node::Node( const string& str, int index ) {
-    // converts to lower case
-    for ( int i = 0; i < (int)( str.length() ); i++ ) {
-        this->str += tolower( str[i] );
-    }
-    this->index = index;
-}
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <thread>
 
-/**
- * Returns a string which represents the letters on the die face.
- */
-const string& Node::getString() {
-    return str;
-}
+const unsigned int LexiconCursor::ROOT;
 
-/**
- * Returns an index which represents the position of the dice.
- */
-int Node::getIndex() {
-    return index;
-}
+// character levels of the TST laid out breadth-first by compact()
+static const unsigned int TOP_LEVELS = 2;
+
+// lookups in flight at once in findMany()
+static const unsigned int BATCH_LANES = 16;
+
+// character level whose subtrees a parallel TST build shards out
+static const unsigned int SHARD_DEPTH = 2;
 
 /**
- * Sets a flag to indicate whether the dice has been visited.
+ * Orders words as std::string does.
  */
-void Node::setVisited( bool visited ) {
-    this->visited = visited;
+static bool wordLess( const WordRef& a, const WordRef& b ) {
+    int c = memcmp( a.data, b.data, std::min( a.length, b.length ) );
+    return c < 0 || ( c == 0 && a.length < b.length );
 }
 
 /**
- * Adds a pointer to an adjacent dice.
+ * Judges whether two words are equal.
  */
-void Node::addNeighbour( Node* n ) {
-    neighbour.push_back( n );
+static bool wordEqual( const WordRef& a, const WordRef& b ) {
+    return a.length == b.length && !memcmp( a.data, b.data, a.length );
 }
 
 /**
- * Judges whether the dice has been visited and compares the
- * letters on the dice is same to part of the specified string.
- *
- * Returns true if both of above are satisfied and false otherwise.
+ * Splits text into lines, lowercases it, and indexes the
+ * non-empty lines as sorted, distinct words.
  */
-bool Node::isMatch( const string& str,
-                            int start,
-                        vector<int> v,
-                              Node* n ) {
-    vector<int>::iterator it;
-    bool isVisited = 0;
-
-    for ( it = v.begin(); it != v.end(); ++it ) {
-        if ( *it == n->getIndex() ) {
-            isVisited = 1;
+void WordList::index() {
+    char *p = text.data(), *end = p + text.size(), *line;
+
+    refs.clear();
+
+    while ( p < end ) {
+        line = p;
+        while ( p < end && *p != '\n' ) {
+            *p = tolower( (unsigned char)*p );
+            p++;
+        }
+        unsigned int length = p - line;
+        if ( length > 0 && line[length-1] == '\r' ) {
+            length--;
+        }
+        if ( length > 0 ) {
+            WordRef ref = { line, length };
+            refs.push_back( ref );
         }
+        p++;
     }
 
-    if ( !str.compare( start, n->str.length(), n->str )
-                                        && !isVisited ) {
-        return 1;
-    }
-    else {
-        return 0;
-    }
+    std::sort( refs.begin(), refs.end(), wordLess );
+    refs.erase( std::unique( refs.begin(), refs.end(), wordEqual ),
+                refs.end() );
 }
 
 /**
- * Searches for a specified string on the board from this dice.
- *
- * Returns a pair, first of which is a vector to store the index
- * information and second of which is a flag to indicate whether
- * the string has been found.
+ * Parses a buffer holding one word per line.
  */
-pair<vector<int>, bool> Node::search( const string& str,
-                                          vector<int> v,
-                                              int start ) {
-    vector<Node*>::iterator it;
-    for ( it = neighbour.begin(); it != neighbour.end(); ++it ) {
+void WordList::parse( const char* buffer, size_t length ) {
+    text.assign( buffer, buffer + length );
+    index();
+}
 
-        vector<int> temp = v;
+/**
+ * Parses a file holding one word per line.
+ *
+ * Returns false if the file cannot be read.
+ */
+bool WordList::read( const char* path ) {
+    std::ifstream infile( path, std::ios::in | std::ios::binary );
+    std::streamoff length;
 
-        if ( isMatch( str, start, temp, *it ) ) {
-            temp.push_back( (*it)->getIndex() );
+    if ( !infile.is_open() ) return 0;
 
-            if ( start + (*it)->str.length() == str.length() ) {
-                return make_pair( temp, 1 );
-            }
+    infile.seekg( 0, std::ios::end );
+    length = infile.tellg();
+    infile.seekg( 0, std::ios::beg );
+    if ( length < 0 ) return 0;
 
-            else if ( start + (*it)->str.length() < str.length() ) {
-                pair<vector<int>, bool> p = (*it)->search( str,
-                                                          temp,
-                                     start + (*it)->str.length() );
-                if ( p.second == 1 )  return p;
-            }
-        }
+    text.resize( length );
+    if ( length > 0 && !infile.read( text.data(), length ) ) {
+        return 0;
     }
-    return make_pair( v, 0 );
+
+    index();
+    return 1;
 }
 
 /**
- * Searches from this dice for all the strings which both the board
- * and lexicon contain and inserts all valid strings to a set.
+ * Takes words from a range of references, in any order and case.
  */
-void Node::searchValid( unsigned int min,
-                      set<string>* words,
-                                TST& tst ) {
-    stack<Node*> s;
-    vector<Node*>::iterator it;
-    Node *temp;
-    string str;
-
-    s.push( this );
-
-    while ( s.size() > 0 ) {
-        temp = s.top();
-        s.pop();
-
-        if ( temp->visited ) {
-            temp->setVisited( 0 );
-            str = str.substr( 0, str.length() - temp->getString().length() );
-        }
-        else if ( tst.isPrefix( str + temp->getString() ) ) {
-            temp->setVisited( 1 );
-            str = str + temp->getString();
-
-            if ( tst.find( str ) && str.length() >= min ) {
-                words->insert( str );
-            }
+void WordList::assign( const WordRef* words, unsigned int count ) {
+    size_t total = 0;
 
-            s.push( temp );
+    for ( unsigned int i = 0; i < count; i++ ) {
+        total += words[i].length + 1;
+    }
 
-            for ( it = temp->neighbour.begin();
-                   it != temp->neighbour.end();
-                                          ++it ) {
-                if ( !( (*it)->visited ) ) {
-                    s.push( *it );
-                }
-            }
-        }
+    text.clear();
+    text.reserve( total );
+    for ( unsigned int i = 0; i < count; i++ ) {
+        text.insert( text.end(), words[i].data,
+                     words[i].data + words[i].length );
+        text.push_back( '\n' );
     }
+
+    index();
 }
 
 /**
@@ -156,152 +132,395 @@ TST::~TST() {
  * Clears the TST.
  */
 void TST::clear() {
-    stack< TSTNode<char>* > s;
-    TSTNode<char> *temp;
-
-    if ( root != nullptr ) {
-        s.push( root );
-    }
+    vector< TSTNode<char> >().swap( nodes );
+    base = nullptr;
+    count = 0;
+}
 
-    while ( s.size() > 0 ) {
-        temp = s.top();
-        s.pop();
-        if ( temp->left != nullptr ) {
-            s.push( temp->left );
-        }
-        if ( temp->middle != nullptr ) {
-            s.push( temp->middle );
-        }
-        if ( temp->right != nullptr ) {
-            s.push( temp->right );
-        }
-        delete temp;
+/**
+ * Copies attached nodes into the arena before a modification.
+ */
+void TST::detach() {
+    if ( count > 0 && base != nodes.data() ) {
+        nodes.assign( base, base + count );
     }
+}
 
-    root = nullptr;
+/**
+ * Points base at the arena after a modification.
+ */
+void TST::refresh() {
+    base = nodes.data();
+    count = nodes.size();
 }
 
 /**
  * Inserts a string to TST.
  */
 void TST::insert( const string& str ) {
-    TSTNode<char> *seek = root, *plug = nullptr;
-    int pos = 0, child = 0;
+    unsigned int curr = 0, next;
+    int pos = 0;
+
+    if ( str.length() == 0 ) return;
+
+    detach();
 
     // if TST is empty
-    if ( root == nullptr && str.length() != 0 ) {
-        root = new TSTNode<char>( str[pos] );
-        plug = root;
-        seek = root->middle;
-        pos = pos + 1;
+    if ( nodes.empty() ) {
+        nodes.push_back( TSTNode<char>( str[pos] ) );
     }
 
-    while ( pos < (int)( str.length() ) && str.length() != 0 ) {
-        if ( seek == nullptr ) {
-            if ( child == -1 ) {
-                plug->left = new TSTNode<char>( str[pos] );
-                plug = plug->left;
-            }
-            else if ( child == 0 ) {
-                plug->middle = new TSTNode<char>( str[pos] );
-                plug = plug->middle;
-            }
-            else {
-                plug->right = new TSTNode<char>( str[pos] );
-                plug = plug->right;
-            }
-            pos = pos + 1;
-            while ( pos < (int)( str.length() ) ) {
-                plug->middle = new TSTNode<char>( str[pos] );
-                plug = plug->middle;
-                pos = pos + 1;
+    // children are created on demand with the character still to
+    // be matched, so the walk simply continues into them; indices
+    // stay valid when push_back reallocates the arena
+    // characters compare as unsigned, the order build() and the
+    // DAWG sort words in
+    while ( 1 ) {
+        if ( (unsigned char)str[pos] < (unsigned char)nodes[curr].digit ) {
+            next = nodes[curr].left;
+            if ( next == 0 ) {
+                next = nodes.size();
+                nodes.push_back( TSTNode<char>( str[pos] ) );
+                nodes[curr].left = next;
             }
         }
-        else if ( str[pos] < seek->digit ) {
-            plug = seek;
-            seek = seek->left;
-            child = -1;
-        }
-        else if ( str[pos] == seek->digit ) {
-            plug = seek;
-            seek = seek->middle;
+        else if ( str[pos] == nodes[curr].digit ) {
             pos = pos + 1;
-            child = 0;
+            if ( pos == (int)( str.length() ) ) {
+                break;
+            }
+            next = nodes[curr].middle;
+            if ( next == 0 ) {
+                next = nodes.size();
+                nodes.push_back( TSTNode<char>( str[pos] ) );
+                nodes[curr].middle = next;
+            }
         }
         else {
-            plug = seek;
-            seek = seek->right;
-            child = 1;
+            next = nodes[curr].right;
+            if ( next == 0 ) {
+                next = nodes.size();
+                nodes.push_back( TSTNode<char>( str[pos] ) );
+                nodes[curr].right = next;
+            }
         }
+        curr = next;
     }
 
     // sets the end bit
-    if ( plug != nullptr ) {
-        plug->end = 1;
-    }
+    nodes[curr].end = 1;
 
+    refresh();
 }
 
 /**
- * Finds whether a specified string is in the TST.
+ * Replaces the contents of the TST with the given words.
  *
- * Returns true if the string is in the TST and false otherwise.
+ * The words must be sorted and distinct. At each character
+ * level the character of the median word becomes the subtree
+ * root, recursively, so the tree is balanced by word count and
+ * comes out the same on every run.
+ *
+ * With more than one thread, the subtrees below each two-letter
+ * prefix are built concurrently and stitched under the top
+ * levels; after compact() the arena is identical to a serial
+ * build's.
  */
-bool TST::find( const string& str ) {
-    TSTNode<char> *curr = root, *prev = nullptr;
-    int pos = 0;
-    while ( pos < (int)( str.length() ) ) {
-        if ( curr == nullptr ) {
-            return 0;
-        }
-        else if ( str[pos] < curr->digit ) {
-            prev = curr;
-            curr = curr->left;
+void TST::build( const WordRef* words, unsigned int n,
+                                  unsigned int threads ) {
+    vector<Shard> shards;
+    vector< vector< TSTNode<char> > > parts;
+    vector<unsigned int> order;
+    vector<std::thread> pool;
+    std::atomic<unsigned int> next( 0 );
+    unsigned int lo = 0;
+
+    clear();
+
+    // an empty word cannot be stored and sorts first
+    while ( lo < n && words[lo].length == 0 ) {
+        lo++;
+    }
+
+    if ( lo < n ) {
+        Build top = { words, &nodes, vector<unsigned int>(),
+                      threads > 1 ? &shards : nullptr, SHARD_DEPTH };
+        buildLevel( top, lo, n, 0 );
+    }
+
+    // largest shards first, so no worker is left with a big one
+    // at the end
+    for ( unsigned int i = 0; i < shards.size(); i++ ) {
+        order.push_back( i );
+    }
+    std::sort( order.begin(), order.end(),
+               [&shards]( unsigned int a, unsigned int b ) {
+                   return shards[a].hi - shards[a].lo
+                        > shards[b].hi - shards[b].lo;
+               } );
+
+    parts.resize( shards.size() );
+    auto work = [&]() {
+        unsigned int i;
+        while ( ( i = next++ ) < order.size() ) {
+            const Shard& shard = shards[ order[i] ];
+            Build b = { words, &parts[ order[i] ], vector<unsigned int>(),
+                        nullptr, 0 };
+            buildLevel( b, shard.lo, shard.hi, SHARD_DEPTH );
         }
-        else if ( str[pos] == curr->digit ) {
-            prev = curr;
-            curr = curr->middle;
-            pos = pos + 1;
+    };
+
+    for ( unsigned int t = 1; t < threads && t < shards.size(); t++ ) {
+        pool.push_back( std::thread( work ) );
+    }
+    work();
+    for ( unsigned int t = 0; t < pool.size(); t++ ) {
+        pool[t].join();
+    }
+
+    // each part has its root at index 0, which no node in it
+    // links to, so relocating by an offset leaves 0 as null
+    for ( unsigned int i = 0; i < shards.size(); i++ ) {
+        unsigned int offset = nodes.size();
+        nodes[ shards[i].node ].middle = offset;
+        for ( unsigned int j = 0; j < parts[i].size(); j++ ) {
+            TSTNode<char> node = parts[i][j];
+            if ( node.left != 0 ) node.left += offset;
+            if ( node.middle != 0 ) node.middle += offset;
+            if ( node.right != 0 ) node.right += offset;
+            nodes.push_back( node );
         }
-        else {
-            prev = curr;
-            curr = curr->right;
+        vector< TSTNode<char> >().swap( parts[i] );
+    }
+
+    refresh();
+}
+
+/**
+ * Builds the BST of the characters at position depth of the
+ * given words, which share their first depth characters and
+ * are all longer than that.
+ *
+ * Returns the index of its root.
+ */
+unsigned int TST::buildLevel( Build& b,
+                              unsigned int lo,
+                              unsigned int hi,
+                              unsigned int depth ) {
+    unsigned int base = b.bounds.size(), root;
+
+    // words are sorted, so equal characters form contiguous groups
+    b.bounds.push_back( lo );
+    for ( unsigned int i = lo + 1; i < hi; i++ ) {
+        if ( b.words[i].data[depth] != b.words[i-1].data[depth] ) {
+            b.bounds.push_back( i );
         }
     }
+    b.bounds.push_back( hi );
+
+    root = buildGroups( b, base, b.bounds.size() - 1, depth );
+
+    b.bounds.resize( base );
+    return root;
+}
 
-    if ( prev != nullptr && prev->end == 1 ) {
-        return 1;
+/**
+ * Builds the BST over groups [lo, hi) of one level, whose
+ * boundaries are stored in bounds, splitting at the median word.
+ *
+ * Returns the index of its root, or 0 if the range is empty.
+ */
+unsigned int TST::buildGroups( Build& b,
+                               unsigned int lo,
+                               unsigned int hi,
+                               unsigned int depth ) {
+    vector< TSTNode<char> >& out = *b.out;
+    unsigned int mid, curr, child;
+    unsigned int first, last;
+
+    if ( lo >= hi ) return 0;
+
+    // the group holding the median word, so that subtrees with
+    // more words below them sit nearer the root
+    first = ( b.bounds[lo] + b.bounds[hi] ) / 2;
+    mid = std::upper_bound( b.bounds.begin() + lo, b.bounds.begin() + hi,
+                            first ) - b.bounds.begin() - 1;
+
+    first = b.bounds[mid];
+    last = b.bounds[mid+1];
+
+    // the node is placed before its subtrees, so the first one
+    // built lands at index 0 as the root
+    curr = out.size();
+    out.push_back( TSTNode<char>( b.words[first].data[depth] ) );
+
+    // the word ending here, if any, sorts first in its group
+    if ( b.words[first].length == depth + 1 ) {
+        out[curr].end = 1;
+        first++;
     }
-    else {
-        return 0;
+
+    if ( first < last ) {
+        if ( b.shards != nullptr && depth + 1 == b.shardDepth ) {
+            Shard shard = { first, last, curr };
+            b.shards->push_back( shard );
+        }
+        else {
+            child = buildLevel( b, first, last, depth + 1 );
+            out[curr].middle = child;
+        }
     }
+
+    child = buildGroups( b, lo, mid, depth );
+    out[curr].left = child;
+    child = buildGroups( b, mid + 1, hi, depth );
+    out[curr].right = child;
+
+    return curr;
 }
 
 /**
- * Judges whether a specified string is a prefix in the TST.
+ * Reorders the arena for locality and trims spare capacity.
  *
- * Returns true if the string is a prefix and false otherwise.
+ * The top character levels are laid out breadth-first at the
+ * front of the arena, everything below them depth-first with
+ * the middle child first so suffix chains are contiguous.
+ * Call once after a batch of inserts.
  */
-bool TST::isPrefix( const string& str ) {
-    TSTNode<char> *curr = root;
-    int pos = 0;
-    while ( pos < (int)( str.length() ) ) {
-        if ( curr == nullptr ) {
-            return 0;
+void TST::compact() {
+    vector< TSTNode<char> > packed;
+    vector<unsigned int> remap( nodes.size() );
+    vector< pair<unsigned int, unsigned int> > top;
+    vector<unsigned int> deep;
+    stack<unsigned int> s;
+    unsigned int next = 0, head = 0;
+
+    detach();
+    if ( nodes.empty() ) return;
+
+    // breadth-first over the first few character levels, which
+    // every lookup passes through
+    top.push_back( make_pair( 0u, 0u ) );
+    while ( head < top.size() ) {
+        unsigned int i = top[head].first, d = top[head].second;
+        head++;
+        remap[i] = next++;
+        const TSTNode<char>& n = nodes[i];
+        if ( n.left != 0 ) top.push_back( make_pair( n.left, d ) );
+        if ( n.middle != 0 ) {
+            if ( d + 1 < TOP_LEVELS ) top.push_back( make_pair( n.middle, d + 1 ) );
+            else deep.push_back( n.middle );
         }
-        else if ( str[pos] < curr->digit ) {
-            curr = curr->left;
+        if ( n.right != 0 ) top.push_back( make_pair( n.right, d ) );
+    }
+
+    // depth-first below that, so each suffix chain is contiguous
+    for ( head = 0; head < deep.size(); head++ ) {
+        s.push( deep[head] );
+        while ( s.size() > 0 ) {
+            unsigned int i = s.top();
+            s.pop();
+            remap[i] = next++;
+            const TSTNode<char>& n = nodes[i];
+            if ( n.right != 0 ) s.push( n.right );
+            if ( n.left != 0 ) s.push( n.left );
+            if ( n.middle != 0 ) s.push( n.middle );
         }
-        else if ( str[pos] == curr->digit ) {
-            curr = curr->middle;
-            pos = pos + 1;
+    }
+
+    packed.resize( nodes.size(), TSTNode<char>( 0 ) );
+    for ( unsigned int i = 0; i < nodes.size(); i++ ) {
+        TSTNode<char> n = nodes[i];
+        if ( n.left != 0 ) n.left = remap[n.left];
+        if ( n.middle != 0 ) n.middle = remap[n.middle];
+        if ( n.right != 0 ) n.right = remap[n.right];
+        packed[ remap[i] ] = n;
+    }
+
+    nodes.swap( packed );
+    refresh();
+}
+
+/**
+ * Finds whether a specified string is in the TST.
+ *
+ * Returns true if the string is in the TST and false otherwise.
+ */
+bool TST::find( const string& str ) {
+    LexiconCursor cursor;
+    return advance( cursor, str.data(), str.length() ) && cursor.end;
+}
+
+/**
+ * Finds which of the specified strings are in the TST.
+ *
+ * Sets hits[i] to whether words[i] is in the TST. Several
+ * lookups advance in lockstep, each prefetching its next node
+ * while the others take their step, so their cache misses
+ * overlap instead of queuing.
+ */
+void TST::findMany( const string* words, unsigned int count,
+                                       vector<bool>& hits ) {
+    struct Lane {
+        const char *str;
+        unsigned int length;
+        unsigned int pos;
+        unsigned int node;
+        unsigned int word;
+    } lanes[BATCH_LANES];
+    unsigned int active = 0, next = 0;
+
+    hits.assign( count, 0 );
+    if ( count == 0 || this->count == 0 ) return;
+
+    while ( 1 ) {
+        // refills free lanes; empty words are never found
+        while ( active < BATCH_LANES && next < count ) {
+            if ( words[next].length() > 0 ) {
+                Lane& l = lanes[active++];
+                l.str = words[next].data();
+                l.length = words[next].length();
+                l.pos = 0;
+                l.node = 0;
+                l.word = next;
+            }
+            next++;
         }
-        else {
-            curr = curr->right;
+        if ( active == 0 ) break;
+
+        // one step for every lane; a finished lane is replaced by
+        // the last one
+        for ( unsigned int i = 0; i < active; ) {
+            Lane& l = lanes[i];
+            const TSTNode<char>& n = base[l.node];
+            unsigned char c = l.str[l.pos], d = n.digit;
+            // 0, 1 or 2 for left, middle or right, without branches
+            unsigned int ge = c >= d, gt = c > d;
+            if ( ge != gt && l.pos + 1 == l.length ) {
+                hits[l.word] = n.end;
+                l = lanes[--active];
+                continue;
+            }
+            l.pos += ge - gt;
+            l.node = ( &n.left )[ ge + gt ];
+            if ( l.node == 0 ) {
+                l = lanes[--active];
+                continue;
+            }
+            __builtin_prefetch( &base[l.node] );
+            i++;
         }
     }
+}
 
-    return 1;
+/**
+ * Judges whether a specified string is a prefix in the TST.
+ *
+ * Returns true if the string is a prefix and false otherwise.
+ */
+bool TST::isPrefix( const string& str ) {
+    LexiconCursor cursor;
+    return advance( cursor, str.data(), str.length() );
 }
 
 /**
@@ -311,5 +530,100 @@ bool TST::isPrefix( const string& str ) {
  * returns false.
  */
 bool TST::isEmpty() {
-    return root == nullptr;
+    return count == 0;
+}
+
+/**
+ * Appends every word in the TST to text, one per line, in
+ * sorted order.
+ */
+void TST::listWords( vector<char>& text ) {
+    string prefix;
+    if ( count > 0 ) {
+        listFrom( 0, prefix, text );
+    }
+}
+
+/**
+ * Appends the words in the subtree at a node, each after the
+ * given prefix, to text.
+ */
+void TST::listFrom( unsigned int node, string& prefix,
+                          vector<char>& text ) const {
+    // in order: left, this node, middle, right; the right spine
+    // is walked in a loop rather than recursed into
+    while ( 1 ) {
+        const TSTNode<char>& n = base[node];
+        if ( n.left != 0 ) {
+            listFrom( n.left, prefix, text );
+        }
+        prefix.push_back( n.digit );
+        if ( n.end ) {
+            text.insert( text.end(), prefix.begin(), prefix.end() );
+            text.push_back( '\n' );
+        }
+        if ( n.middle != 0 ) {
+            listFrom( n.middle, prefix, text );
+        }
+        prefix.resize( prefix.length() - 1 );
+        if ( n.right == 0 ) break;
+        node = n.right;
+    }
+}
+
+/**
+ * Returns the number of nodes in the arena.
+ */
+unsigned int TST::size() {
+    return count;
+}
+
+/**
+ * Returns the nodes, in the layout written to snapshots.
+ */
+const TSTNode<char>* TST::data() {
+    return base;
+}
+
+/**
+ * Copies the nodes into bytes, in the layout of data(), field by
+ * field, with every padding byte 0.
+ */
+void TST::copyNodes( vector<unsigned char>& bytes ) const {
+    const size_t size = sizeof( TSTNode<char> );
+
+    bytes.assign( (size_t)count * size, 0 );
+    for ( unsigned int i = 0; i < count; i++ ) {
+        unsigned char* out = &bytes[ (size_t)i * size ];
+        const TSTNode<char>& n = base[i];
+        memcpy( out + offsetof( TSTNode<char>, left ), &n.left, sizeof( n.left ) );
+        memcpy( out + offsetof( TSTNode<char>, middle ), &n.middle, sizeof( n.middle ) );
+        memcpy( out + offsetof( TSTNode<char>, right ), &n.right, sizeof( n.right ) );
+        memcpy( out + offsetof( TSTNode<char>, digit ), &n.digit, sizeof( n.digit ) );
+        memcpy( out + offsetof( TSTNode<char>, end ), &n.end, sizeof( n.end ) );
+    }
+}
+
+/**
+ * Makes the TST read nodes in place from external memory,
+ * such as a mapped snapshot, which must outlive the TST or
+ * the next clear(). Any change copies them into the arena.
+ *
+ * Returns false, leaving the TST as it was, if there is no node
+ * or a child index points past the last one.
+ */
+bool TST::attach( const TSTNode<char>* nodes, unsigned int count ) {
+    // checked once here, so lookups never leave the nodes
+    if ( count == 0 ) return 0;
+    for ( unsigned int i = 0; i < count; i++ ) {
+        if ( nodes[i].left >= count || nodes[i].middle >= count
+                || nodes[i].right >= count ) {
+            return 0;
+        }
+    }
+
+    clear();
+    this->base = nodes;
+    this->count = count;
+    return 1;
 }
@@ -9,128 +9,231 @@
 #include <locale>
 
 using std::pair;
+using std::make_pair;
 using std::vector;
 using std::stack;
 using std::set;
 using std::string;
 using std::locale;
 
-class TST;
+class Lexicon;
 
 /**
- * Represents a dice in a board.
+ * Represents a position in a lexicon after matching a prefix.
  *
- * Node contains a string to represent single or multiple
- * letters on the die face, contains an index to locate
- * dice's position, contains a flag to represent whether
- * the dice has been visited, contains a vector of pointers
- * to store the address of its adjacent dices.
+ * pos is the backend's index of the last matched node, or ROOT
+ * before anything has been matched; end is set when the matched
+ * prefix is itself a word.
  */
-class Node {
+struct LexiconCursor {
+    static const unsigned int ROOT = 0xffffffff;
+    unsigned int pos;
+    bool end;
 
-private:
-    string str;
-    int index;
-    bool visited;
-    vector<Node*> neighbour;
+    LexiconCursor() : pos(ROOT), end(0) {}
+};
+
+/**
+ * Selects the structure a lexicon is built into.
+ */
+enum LexiconType {
+    TST_LEXICON,
+    DAWG_LEXICON
+};
 
+/**
+ * Represents a lexicon which the board search can query.
+ *
+ * Implemented by TST and by DAWG; BogglePlayer holds whichever
+ * one was selected through this interface.
+ */
+class Lexicon {
+
+public:
     /**
-     * Judges whether the dice has been visited and compares the
-     * letters on the dice is same to part of the specified string.
-     *
-     * Returns true if both of above are satisfied and false otherwise.
+     * Finds whether a specified string is in the lexicon.
      */
-    bool isMatch(const string& str, int start, vector<int> v, Node* n);
+    virtual bool find(const string& str) = 0;
 
-public:
     /**
-     * Constructs a Node from the given parameters.
+     * Finds which of the specified strings are in the lexicon.
+     *
+     * Sets hits[i] to whether words[i] is in the lexicon. Several
+     * lookups advance in lockstep, so their cache misses overlap.
      */
-    Node(const string& str, int index);
+    virtual void findMany(const string* words, unsigned int count,
+                          vector<bool>& hits) = 0;
 
     /**
-     * Destructs the Node.
+     * Judges whether a specified string is a prefix in the lexicon.
      */
-    ~Node() {}
+    virtual bool isPrefix(const string& str) = 0;
 
     /**
-     * Returns a string which represents the letters on the die face.
+     * Judges whether the lexicon is empty.
      */
-    const string& getString();
+    virtual bool isEmpty() = 0;
 
     /**
-     * Returns an index which represents the position of the dice.
+     * Appends every word in the lexicon to text, one per line,
+     * in sorted order.
      */
-    int getIndex();
+    virtual void listWords(vector<char>& text) = 0;
+
+    virtual ~Lexicon() {}
+
+};
+
+/**
+ * Refers to a word stored elsewhere, without copying it.
+ */
+struct WordRef {
+    const char* data;
+    unsigned int length;
+};
 
+/**
+ * Represents a list of words parsed into one shared buffer.
+ *
+ * Every source is copied into text once and lowercased in place;
+ * refs then point into text, sorted and without duplicates, ready
+ * for TST::build() or a DAWGBuilder. No per-word allocation is made.
+ */
+class WordList {
+
+private:
     /**
-     * Sets a flag to indicate whether the dice has been visited.
+     * Splits text into lines, lowercases it, and indexes the
+     * non-empty lines as sorted, distinct words.
      */
-    void setVisited(bool visited);
+    void index();
+
+public:
+    vector<char> text;
+    vector<WordRef> refs;
 
     /**
-     * Adds a pointer to an adjacent dice.
+     * Parses a buffer holding one word per line.
      */
-    void addNeighbour(Node* n);
+    void parse(const char* buffer, size_t length);
 
     /**
-     * Searches for a specified string on the board from this dice.
+     * Parses a file holding one word per line.
      *
-     * Returns a pair, first of which is a vector to store the index
-     * information and second of which is a flag to indicate whether
-     * the string has been found.
+     * Returns false if the file cannot be read.
      */
-    pair<vector<int>, bool> search(const string& str,
-                                       vector<int> v,
-                                           int start);
+    bool read(const char* path);
 
     /**
-     * Searches from this dice for all the strings which both the board
-     * and lexicon contain and inserts all valid strings to a set.
+     * Takes words from a range of references, in any order and case.
      */
-    void searchValid(unsigned int min,
-                   set<string>* words,
-                             TST& tst);
+    void assign(const WordRef* words, unsigned int count);
 
 };
 
 /**
  * Represents a Ternary Search Tree Node.
+ *
+ * Children are 32-bit indices into the owning TST's node arena
+ * rather than pointers. Index 0 always holds the root, which is
+ * never anybody's child, so 0 doubles as the null index.
  */
 template<typename T>
 class TSTNode {
 
 public:
-    TSTNode<T> *left;
-    TSTNode<T> *middle;
-    TSTNode<T> *right;
-    const T digit;
+    unsigned int left;
+    unsigned int middle;
+    unsigned int right;
+    T digit;
     bool end;
 
     /**
      * Constructs a TSTNode.
      */
-    TSTNode( const T& d ) : digit(d), end(0) {
-        left = middle = right = nullptr;
-    }
+    TSTNode( const T& d ) : left(0), middle(0), right(0), digit(d), end(0) {}
 
 };
 
 /**
  * Represents a Ternary Search Tree.
+ *
+ * All nodes live in one contiguous arena, so clearing the tree
+ * frees a single block and lookups walk a dense array. Lookups go
+ * through base, which points either at the arena or at nodes
+ * attached from a mapped snapshot.
  */
-class TST {
+class TST : public Lexicon {
 
 private:
-    TSTNode<char> *root;
+    vector< TSTNode<char> > nodes;
+    const TSTNode<char> *base;
+    unsigned int count;
 
-public:
-    friend class Node;
+    /**
+     * Copies attached nodes into the arena before a modification.
+     */
+    void detach();
+
+    /**
+     * Points base at the arena after a modification.
+     */
+    void refresh();
+
+    /**
+     * A subtree left for a worker thread by a parallel build.
+     */
+    struct Shard {
+        unsigned int lo;
+        unsigned int hi;
+        unsigned int node;
+    };
+
+    /**
+     * State of one bulk build into an arena.
+     *
+     * If shards is set, levels at shardDepth are not built but
+     * recorded there, to be built separately and stitched in.
+     */
+    struct Build {
+        const WordRef* words;
+        vector< TSTNode<char> >* out;
+        vector<unsigned int> bounds;
+        vector<Shard>* shards;
+        unsigned int shardDepth;
+    };
+
+    /**
+     * Builds the BST of the characters at position depth of the
+     * given words, which share their first depth characters and
+     * are all longer than that.
+     *
+     * Returns the index of its root.
+     */
+    static unsigned int buildLevel(Build& b, unsigned int lo,
+                                   unsigned int hi, unsigned int depth);
 
+    /**
+     * Builds the BST over groups [lo, hi) of one level, whose
+     * boundaries are stored in bounds, splitting at the median word.
+     *
+     * Returns the index of its root, or 0 if the range is empty.
+     */
+    static unsigned int buildGroups(Build& b, unsigned int lo,
+                                    unsigned int hi, unsigned int depth);
+
+    /**
+     * Appends the words in the subtree at a node, each after the
+     * given prefix, to text.
+     */
+    void listFrom(unsigned int node, string& prefix,
+                  vector<char>& text) const;
+
+public:
     /**
      * Constructs a TST.
      */
-    TST() : root(nullptr) {}
+    TST() : base(nullptr), count(0) {}
 
     /**
      * Destructs a TST.
@@ -149,6 +252,43 @@ public:
      */
     void insert(const string& str);
 
+    /**
+     * Replaces the contents of the TST with the given words.
+     *
+     * The words must be sorted and distinct. At each character
+     * level the character of the median word becomes the subtree
+     * root, recursively, so the tree is balanced by word count and
+     * comes out the same on every run. Siblings are ordered by
+     * their characters as unsigned bytes, as memcmp() orders the
+     * words and as insert() and the lookups compare them.
+     *
+     * With more than one thread, the subtrees below each two-letter
+     * prefix are built concurrently and stitched under the top
+     * levels; after compact() the arena is identical to a serial
+     * build's.
+     */
+    void build(const WordRef* words, unsigned int n,
+               unsigned int threads = 1);
+
+    /**
+     * Advances a cursor by the specified characters.
+     *
+     * Returns false if the cursor's prefix followed by the
+     * characters is not a prefix in the TST; the cursor is then
+     * left in an unspecified state.
+     */
+    bool advance(LexiconCursor& cursor, const char* s, unsigned int n) const;
+
+    /**
+     * Reorders the arena for locality and trims spare capacity.
+     *
+     * The top character levels are laid out breadth-first at the
+     * front of the arena, everything below them depth-first with
+     * the middle child first so suffix chains are contiguous.
+     * Call once after a batch of inserts.
+     */
+    void compact();
+
     /**
      * Finds whether a specified string is in the TST.
      *
@@ -156,6 +296,17 @@ public:
      */
     bool find(const string& str);
 
+    /**
+     * Finds which of the specified strings are in the TST.
+     *
+     * Sets hits[i] to whether words[i] is in the TST. Several
+     * lookups advance in lockstep, each prefetching its next node
+     * while the others take their step, so their cache misses
+     * overlap instead of queuing.
+     */
+    void findMany(const string* words, unsigned int count,
+                  vector<bool>& hits);
+
     /**
      * Judges whether a specified string is a prefix in the TST.
      *
@@ -171,6 +322,78 @@ public:
      */
     bool isEmpty();
 
+    /**
+     * Appends every word in the TST to text, one per line, in
+     * sorted order.
+     */
+    void listWords(vector<char>& text);
+
+    /**
+     * Returns the number of nodes in the arena.
+     */
+    unsigned int size();
+
+    /**
+     * Returns the nodes, in the layout written to snapshots.
+     */
+    const TSTNode<char>* data();
+
+    /**
+     * Copies the nodes into bytes, in the layout of data(), field
+     * by field, so the padding between and after the fields is 0
+     * rather than whatever memory the nodes were made in.
+     */
+    void copyNodes(vector<unsigned char>& bytes) const;
+
+    /**
+     * Makes the TST read nodes in place from external memory,
+     * such as a mapped snapshot, which must outlive the TST or
+     * the next clear(). Any change copies them into the arena.
+     *
+     * Returns false, leaving the TST as it was, if there is no
+     * node or a child index points past the last one.
+     */
+    bool attach(const TSTNode<char>* nodes, unsigned int count);
+
 };
 
+/**
+ * Advances a cursor by the specified characters.
+ *
+ * Returns false if the cursor's prefix followed by the
+ * characters is not a prefix in the TST; the cursor is then
+ * left in an unspecified state.
+ */
+inline bool TST::advance( LexiconCursor& cursor,
+                          const char* s,
+                          unsigned int n ) const {
+    unsigned int curr;
+
+    if ( n == 0 ) return 1;
+
+    for ( unsigned int i = 0; i < n; i++ ) {
+        if ( cursor.pos == LexiconCursor::ROOT ) {
+            if ( count == 0 ) return 0;
+            curr = 0;
+        }
+        else {
+            curr = base[cursor.pos].middle;
+            if ( curr == 0 ) return 0;
+        }
+        while ( s[i] != base[curr].digit ) {
+            if ( (unsigned char)s[i] < (unsigned char)base[curr].digit ) {
+                curr = base[curr].left;
+            }
+            else {
+                curr = base[curr].right;
+            }
+            if ( curr == 0 ) return 0;
+        }
+        cursor.pos = curr;
+    }
+
+    cursor.end = base[cursor.pos].end;
+    return 1;
+}
+
 #endif // BOGGLEUTIL_H
@@ -0,0 +1,44 @@
+/******************************************************
+ * Builds a lexicon snapshot from a text word list, for
+ * BogglePlayer::attachLexicon().
+ *
+ * Usage: bogsnap [-dawg] [-j threads] wordlist snapshot
+ * ****************************************************/
+
+#include "boggleplayer.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main (int argc, char* argv[]) {
+
+  BogglePlayer p;
+  int arg = 1;
+
+  if(argc > arg && !strcmp(argv[arg], "-dawg")) {
+    p.setLexiconType(DAWG_LEXICON);
+    arg++;
+  }
+  if(argc > arg + 1 && !strcmp(argv[arg], "-j")) {
+    p.setBuildThreads(atoi(argv[arg + 1]));
+    arg += 2;
+  }
+  if(argc != arg + 2) {
+    std::cerr << "Usage: " << argv[0] << " [-dawg] [-j threads] wordlist snapshot" << std::endl;
+    return -1;
+  }
+
+  if(!p.loadLexicon(argv[arg])) {
+    std::cerr << "Could not open word list " << argv[arg] << "." << std::endl;
+    return -1;
+  }
+
+  if(!p.saveLexicon(argv[arg + 1])) {
+    std::cerr << "Could not write snapshot " << argv[arg + 1] << "." << std::endl;
+    return -1;
+  }
+  std::cout << "Lexicon from " << argv[arg] << " written to " << argv[arg + 1] << "." << std::endl;
+
+  return 0;
+
+}
@@ -4,10 +4,1644 @@
 
 #include "baseboggleplayer.h"
 #include "boggleplayer.h"
+#include "boggleutil.h"
+#include "bogglelexicon.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
+#include <cstring>
+#include <random>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// words with bytes above 0x7f, which sort after every ASCII letter
+static const char* const NON_ASCII[] = {
+  "abc", "ab\xc3\xa9", "abz", "bat", "b\xc3\xa9t", "\xc3\xa9t\xc3\xa9",
+  "\xc3\xa9", "zoo", "z\xc3\xbc", "\xc3\xbc" "ber", "a"
+};
+static const unsigned int NON_ASCII_WORDS = 11;
+
+// strings near those words, to look up alongside them
+static const char* const NON_ASCII_PROBES[] = {
+  "ab", "ab\xc3", "abd", "b", "b\xc3\xa9", "ba", "\xc3", "\xc3\xa9t", "z",
+  "zo", "x\xc3\xa9", "\xc3\xbc", "abcd", "\xff"
+};
+static const unsigned int NON_ASCII_PROBE_COUNT = 14;
+
+/**
+ * Checks that a TST built in bulk from non-ASCII words and one
+ * built by insert() find the same words and prefixes, in single
+ * and batched lookups.
+ */
+static int testNonAscii() {
+  vector<WordRef> refs;
+  vector<string> probes;
+  set<string> expected;
+  vector<bool> builtHits, insertedHits;
+  TST built, inserted;
+
+  for(unsigned int i = 0; i < NON_ASCII_WORDS; i++) {
+    inserted.insert(NON_ASCII[i]);
+    expected.insert(NON_ASCII[i]);
+    probes.push_back(NON_ASCII[i]);
+  }
+  for(unsigned int i = 0; i < NON_ASCII_PROBE_COUNT; i++) {
+    probes.push_back(NON_ASCII_PROBES[i]);
+  }
+  // a set orders its strings as memcmp() does, as build() takes them
+  for(set<string>::iterator it = expected.begin(); it != expected.end(); it++) {
+    WordRef ref = {it->data(), (unsigned int)it->length()};
+    refs.push_back(ref);
+  }
+  built.build(refs.data(), refs.size());
+
+  built.findMany(probes.data(), probes.size(), builtHits);
+  inserted.findMany(probes.data(), probes.size(), insertedHits);
+  for(unsigned int i = 0; i < probes.size(); i++) {
+    bool word = expected.count(probes[i]) == 1, prefix = false;
+    for(set<string>::iterator it = expected.begin(); it != expected.end(); it++) {
+      if(it->compare(0, probes[i].length(), probes[i]) == 0) prefix = true;
+    }
+    if(built.find(probes[i]) != word || inserted.find(probes[i]) != word
+       || builtHits[i] != word || insertedHits[i] != word) {
+      std::cerr << "Apparent problem with non-ASCII words #1." << std::endl;
+      return -1;
+    }
+    if(built.isPrefix(probes[i]) != prefix || inserted.isPrefix(probes[i]) != prefix) {
+      std::cerr << "Apparent problem with non-ASCII words #2." << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that TSTs built in bulk by one thread and by several from
+ * many non-ASCII words hold the same nodes after compact(), and
+ * list and find every word.
+ */
+static int testParallelBuild() {
+  static const char* const PIECES[] = {
+    "a", "b", "e", "r", "s", "t", "z", "\xc3\xa9", "\xc3\xbc", "\xc3\x9f", "\xe2\x82\xac"
+  };
+  std::mt19937 rng(7);
+  vector<string> text;
+  vector<WordRef> refs;
+  WordList list;
+  vector<char> serialWords, parallelWords, expected;
+  TST serial, parallel;
+
+  for(unsigned int i = 0; i < 20000; i++) {
+    string word;
+    unsigned int length = 1 + rng() % 8;
+    for(unsigned int k = 0; k < length; k++) word += PIECES[rng() % 11];
+    text.push_back(word);
+  }
+  for(unsigned int i = 0; i < text.size(); i++) {
+    WordRef ref = {text[i].data(), (unsigned int)text[i].length()};
+    refs.push_back(ref);
+  }
+  list.assign(refs.data(), refs.size());
+
+  serial.build(list.refs.data(), list.refs.size(), 1);
+  serial.compact();
+  parallel.build(list.refs.data(), list.refs.size(), 4);
+  parallel.compact();
+
+  if(serial.size() != parallel.size()) {
+    std::cerr << "Apparent problem with parallel build #1." << std::endl;
+    return -1;
+  }
+  for(unsigned int i = 0; i < serial.size(); i++) {
+    const TSTNode<char>& a = serial.data()[i];
+    const TSTNode<char>& b = parallel.data()[i];
+    if(a.left != b.left || a.middle != b.middle || a.right != b.right
+       || a.digit != b.digit || a.end != b.end) {
+      std::cerr << "Apparent problem with parallel build #2." << std::endl;
+      return -1;
+    }
+  }
+
+  for(unsigned int i = 0; i < list.refs.size(); i++) {
+    expected.insert(expected.end(), list.refs[i].data,
+                    list.refs[i].data + list.refs[i].length);
+    expected.push_back('\n');
+  }
+  serial.listWords(serialWords);
+  parallel.listWords(parallelWords);
+  if(serialWords != expected || parallelWords != expected) {
+    std::cerr << "Apparent problem with parallel build #3." << std::endl;
+    return -1;
+  }
+  for(unsigned int i = 0; i < text.size(); i++) {
+    if(!serial.find(text[i]) || !parallel.find(text[i])) {
+      std::cerr << "Apparent problem with parallel build #4." << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// faces the test boards are rolled from, in mixed case as setBoard()
+// may be given them
+static const char* const TEST_FACES[] = {
+  "a", "e", "i", "o", "r", "s", "t", "n", "l", "E", "T", "Qu"
+};
+static const unsigned int TEST_FACE_COUNT = 12;
+
+/**
+ * A board for the tests: its faces, row by row, and the array of
+ * rows setBoard() takes.
+ */
+struct TestBoard {
+  unsigned int rows;
+  unsigned int cols;
+  vector<string> faces;
+  vector<string*> array;
+
+  TestBoard(unsigned int rows, unsigned int cols)
+    : rows(rows), cols(cols), faces(rows * cols) {}
+
+  string** dice() {
+    array.clear();
+    for(unsigned int r = 0; r < rows; r++) array.push_back(&faces[r * cols]);
+    return array.data();
+  }
+
+  string lower(unsigned int cell) const {
+    string face = faces[cell];
+    for(unsigned int k = 0; k < face.length(); k++) face[k] = tolower(face[k]);
+    return face;
+  }
+};
+
+/**
+ * Rolls a board of random faces.
+ */
+static TestBoard rollTestBoard(unsigned int rows, unsigned int cols,
+                               std::mt19937& rng) {
+  TestBoard board(rows, cols);
+  for(unsigned int c = 0; c < rows * cols; c++) {
+    board.faces[c] = TEST_FACES[rng() % TEST_FACE_COUNT];
+  }
+  return board;
+}
+
+/**
+ * Judges whether two cells of a board touch.
+ */
+static bool adjacent(const TestBoard& board, unsigned int a, unsigned int b) {
+  int dr = (int)(a / board.cols) - (int)(b / board.cols);
+  int dc = (int)(a % board.cols) - (int)(b % board.cols);
+  return a != b && dr >= -1 && dr <= 1 && dc >= -1 && dc <= 1;
+}
+
+/**
+ * Judges whether a path is a simple path of touching cells whose
+ * faces spell a word.
+ */
+static bool validPath(const TestBoard& board, const string& word,
+                      const unsigned int* path, unsigned int cells) {
+  string spelled;
+  set<unsigned int> seen;
+  for(unsigned int k = 0; k < cells; k++) {
+    if(path[k] >= board.rows * board.cols || !seen.insert(path[k]).second) return false;
+    if(k > 0 && !adjacent(board, path[k-1], path[k])) return false;
+    spelled += board.lower(path[k]);
+  }
+  return cells > 0 && spelled == word;
+}
+
+/**
+ * A lexicon for the tests, with every prefix of its words.
+ */
+struct TestLexicon {
+  set<string> words;
+  set<string> prefixes;
+};
+
+/**
+ * Makes a lexicon of the words spelled by random walks on random
+ * boards, so boards rolled from the same faces hold many of them,
+ * and of as many random strings.
+ */
+static TestLexicon makeTestLexicon(std::mt19937& rng) {
+  TestLexicon lex;
+  for(unsigned int b = 0; b < 40; b++) {
+    TestBoard board = rollTestBoard(5, 5, rng);
+    for(unsigned int w = 0; w < 100; w++) {
+      unsigned int cell = rng() % 25, length = 1 + rng() % 8;
+      set<unsigned int> seen;
+      string word;
+      for(unsigned int k = 0; k < length; k++) {
+        vector<unsigned int> next;
+        seen.insert(cell);
+        word += board.lower(cell);
+        for(unsigned int c = 0; c < 25; c++) {
+          if(adjacent(board, cell, c) && !seen.count(c)) next.push_back(c);
+        }
+        if(next.empty()) break;
+        cell = next[rng() % next.size()];
+      }
+      lex.words.insert(word);
+    }
+  }
+  for(unsigned int w = 0; w < 4000; w++) {
+    string word;
+    unsigned int length = 1 + rng() % 10;
+    for(unsigned int k = 0; k < length; k++) word += (char)('a' + rng() % 26);
+    lex.words.insert(word);
+  }
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    for(unsigned int k = 1; k <= it->length(); k++) lex.prefixes.insert(it->substr(0, k));
+  }
+  return lex;
+}
+
+/**
+ * Collects the words of a lexicon on a board by trying every path
+ * its prefixes allow.
+ */
+static void solveFrom(const TestBoard& board, const TestLexicon& lex,
+                      unsigned int cell, string& prefix,
+                      vector<bool>& used, set<string>& words) {
+  unsigned int length = prefix.length();
+  prefix += board.lower(cell);
+  if(lex.prefixes.count(prefix)) {
+    if(lex.words.count(prefix)) words.insert(prefix);
+    used[cell] = true;
+    for(unsigned int c = 0; c < board.rows * board.cols; c++) {
+      if(!used[c] && adjacent(board, cell, c)) solveFrom(board, lex, c, prefix, used, words);
+    }
+    used[cell] = false;
+  }
+  prefix.resize(length);
+}
+
+/**
+ * Returns the words of at least min letters of a lexicon on a
+ * board, found the slow way.
+ */
+static set<string> solveTestBoard(const TestBoard& board,
+                                  const TestLexicon& lex, unsigned int min) {
+  set<string> all, words;
+  vector<bool> used(board.rows * board.cols, false);
+  string prefix;
+  for(unsigned int c = 0; c < board.rows * board.cols; c++) {
+    solveFrom(board, lex, c, prefix, used, all);
+  }
+  for(set<string>::iterator it = all.begin(); it != all.end(); it++) {
+    if(it->length() >= min) words.insert(*it);
+  }
+  return words;
+}
+
+// board shapes the tests solve, from a single die to more than
+// the 64 cells a bit mask holds
+static const unsigned int TEST_SHAPES[][2] = {
+  {1, 1}, {2, 3}, {4, 4}, {5, 5}, {3, 7}, {6, 6}, {9, 8}
+};
+static const unsigned int TEST_SHAPE_COUNT = 7;
+
+/**
+ * Checks that a DAWG and a TST built from the same words hold the
+ * same words and prefixes, and find the same words on boards as a
+ * plain search of every path does.
+ */
+static int testDawg() {
+  std::mt19937 rng(2);
+  TestLexicon lex = makeTestLexicon(rng);
+  BogglePlayer tst, dawg;
+  vector<string> probes;
+  vector<bool> tstHits, dawgHits;
+
+  dawg.setLexiconType(DAWG_LEXICON);
+  tst.buildLexicon(lex.words);
+  dawg.buildLexicon(lex.words);
+
+  for(set<string>::iterator it = lex.prefixes.begin(); it != lex.prefixes.end(); it++) {
+    probes.push_back(*it);
+    probes.push_back(*it + "q");
+  }
+  tst.isInLexicon(probes.data(), probes.size(), &tstHits);
+  dawg.isInLexicon(probes.data(), probes.size(), &dawgHits);
+  for(unsigned int i = 0; i < probes.size(); i++) {
+    bool word = lex.words.count(probes[i]) == 1;
+    if(tst.isInLexicon(probes[i]) != word || dawg.isInLexicon(probes[i]) != word
+       || tstHits[i] != word || dawgHits[i] != word) {
+      std::cerr << "Apparent problem with the DAWG #1." << std::endl;
+      return -1;
+    }
+  }
+
+  for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+    for(unsigned int b = 0; b < 4; b++) {
+      TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+      set<string> expected = solveTestBoard(board, lex, b), tstWords, dawgWords;
+      tst.setBoard(board.rows, board.cols, board.dice());
+      dawg.setBoard(board.rows, board.cols, board.dice());
+      if(!tst.getAllValidWords(b, &tstWords) || !dawg.getAllValidWords(b, &dawgWords)
+         || tstWords != expected || dawgWords != expected) {
+        std::cerr << "Apparent problem with the DAWG #2." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that a TST snapshot holds only 0 in the padding of its
+ * nodes, so the same lexicon always gives the same file, and that
+ * it attaches again.
+ */
+static int testSnapshotPadding() {
+  static const char* const PATH = "bogtest.snapshot";
+  const size_t size = sizeof(TSTNode<char>);
+  const size_t used = offsetof(TSTNode<char>, end) + sizeof(bool);
+  std::mt19937 rng(5);
+  TestLexicon lex = makeTestLexicon(rng);
+  BogglePlayer saved, attached;
+  vector<char> file;
+  bool ok;
+
+  saved.buildLexicon(lex.words);
+  ok = saved.saveLexicon(PATH);
+  if(ok) {
+    std::ifstream in(PATH, std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    ok = attached.attachLexicon(PATH);
+  }
+  remove(PATH);
+  if(!ok || file.size() < sizeof(SnapshotHeader)
+     || (file.size() - sizeof(SnapshotHeader)) % size != 0) {
+    std::cerr << "Apparent problem with snapshots #1." << std::endl;
+    return -1;
+  }
+
+  for(size_t node = sizeof(SnapshotHeader); node < file.size(); node += size) {
+    for(size_t k = used; k < size; k++) {
+      if(file[node + k] != 0) {
+        std::cerr << "Apparent problem with snapshots #2." << std::endl;
+        return -1;
+      }
+    }
+  }
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    if(!attached.isInLexicon(*it)) {
+      std::cerr << "Apparent problem with snapshots #3." << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// board shapes the threaded tests solve, up to far more cells than
+// threads
+static const unsigned int THREAD_SHAPES[][2] = {
+  {2, 2}, {4, 4}, {5, 5}, {9, 8}, {12, 12}, {20, 20}
+};
+static const unsigned int THREAD_SHAPE_COUNT = 6;
+
+/**
+ * Checks that getAllValidWords() with several threads finds the
+ * same words as with one, and as a plain search of every path, on
+ * both lexicon structures.
+ */
+static int testSolveThreads() {
+  std::mt19937 rng(12);
+  TestLexicon lex = makeTestLexicon(rng);
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer serial, threaded;
+    if(t == 1) {
+      serial.setLexiconType(DAWG_LEXICON);
+      threaded.setLexiconType(DAWG_LEXICON);
+    }
+    serial.buildLexicon(lex.words);
+    threaded.buildLexicon(lex.words);
+    threaded.setSolveThreads(4);
+
+    for(unsigned int s = 0; s < THREAD_SHAPE_COUNT; s++) {
+      TestBoard board = rollTestBoard(THREAD_SHAPES[s][0], THREAD_SHAPES[s][1], rng);
+      set<string> expected = solveTestBoard(board, lex, 2), serialWords, threadedWords;
+      serial.setBoard(board.rows, board.cols, board.dice());
+      threaded.setBoard(board.rows, board.cols, board.dice());
+      if(!serial.getAllValidWords(2, &serialWords) || !threaded.getAllValidWords(2, &threadedWords)
+         || serialWords != expected || threadedWords != expected) {
+        std::cerr << "Apparent problem with threaded solves #1." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that splitting subtrees off for idle threads loses and
+ * repeats no word, on a board where every word starts from one
+ * die, so the threads given the other start cells soon wait for
+ * work.
+ */
+static int testSplitSearch() {
+  std::mt19937 rng(13);
+  TestBoard board = rollTestBoard(7, 7, rng);
+  TestLexicon lex;
+  BoardGrid grid;
+  TST tst;
+  vector<string> sorted;
+  vector<WordRef> refs;
+  unsigned int splits = 0;
+
+  // every word is a walk from the middle die, the only z
+  board.faces[24] = "z";
+  for(unsigned int w = 0; w < 3000; w++) {
+    unsigned int cell = 24, length = 2 + rng() % 10;
+    set<unsigned int> seen;
+    string word;
+    for(unsigned int k = 0; k < length; k++) {
+      vector<unsigned int> next;
+      seen.insert(cell);
+      word += board.lower(cell);
+      for(unsigned int c = 0; c < 49; c++) {
+        if(adjacent(board, cell, c) && !seen.count(c)) next.push_back(c);
+      }
+      if(next.empty()) break;
+      cell = next[rng() % next.size()];
+    }
+    lex.words.insert(word);
+  }
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    for(unsigned int k = 1; k <= it->length(); k++) lex.prefixes.insert(it->substr(0, k));
+    sorted.push_back(*it);
+  }
+  for(unsigned int i = 0; i < sorted.size(); i++) {
+    WordRef ref = {sorted[i].data(), (unsigned int)sorted[i].length()};
+    refs.push_back(ref);
+  }
+  tst.build(refs.data(), refs.size());
+  grid.assign(board.rows, board.cols, board.dice());
+
+  set<string> expected = solveTestBoard(board, lex, 0);
+  for(unsigned int run = 0; run < 20; run++) {
+    WordPaths found;
+    SearchStats stats;
+    set<string> words;
+    searchGrid(grid, tst, 0, &found, 4, TaskPool::SPLIT_DEPTH, &stats);
+    for(unsigned int w = 0; w < found.size(); w++) {
+      words.insert(string(found.wordData(w), found.wordLength(w)));
+    }
+    if(words != expected || found.size() != expected.size()) {
+      std::cerr << "Apparent problem with split searches #1." << std::endl;
+      return -1;
+    }
+    splits += stats.tasks > board.rows * board.cols;
+  }
+  // the idle threads should have had subtrees split off for them
+  if(splits == 0) {
+    std::cerr << "Apparent problem with split searches #2." << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Checks that every word getAllValidWords() passes to a sink comes
+ * once, with a path spelling it, whatever the lexicon structure,
+ * thread count and board filter.
+ */
+static int testWordPaths() {
+  std::mt19937 rng(15);
+  TestLexicon lex = makeTestLexicon(rng);
+
+  for(unsigned int v = 0; v < 8; v++) {
+    BogglePlayer p;
+    if(v & 1) p.setLexiconType(DAWG_LEXICON);
+    if(v & 2) p.setSolveThreads(4);
+    p.setBoardFilter(v & 4);
+    p.buildLexicon(lex.words);
+
+    for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+      TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+      set<string> expected = solveTestBoard(board, lex, 0), words;
+      WordPaths found;
+      p.setBoard(board.rows, board.cols, board.dice());
+      if(!p.getAllValidWords(0, &found)) {
+        std::cerr << "Apparent problem with word paths #1." << std::endl;
+        return -1;
+      }
+      for(unsigned int w = 0; w < found.size(); w++) {
+        string word(found.wordData(w), found.wordLength(w));
+        words.insert(word);
+        if(!validPath(board, word, found.path(w), found.pathLength(w))) {
+          std::cerr << "Apparent problem with word paths #2." << std::endl;
+          return -1;
+        }
+      }
+      if(words != expected || found.size() != expected.size()) {
+        std::cerr << "Apparent problem with word paths #3." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Finds whether a word can be spelled along a simple path from a
+ * cell, the slow way.
+ */
+static bool spellFrom(const TestBoard& board, const string& word,
+                      unsigned int pos, unsigned int cell, vector<bool>& used) {
+  string face = board.lower(cell);
+  if(face.empty() || word.compare(pos, face.length(), face) != 0) return false;
+  if(pos + face.length() == word.length()) return true;
+  used[cell] = true;
+  for(unsigned int c = 0; c < board.rows * board.cols; c++) {
+    if(!used[c] && adjacent(board, cell, c) && spellFrom(board, word, pos + face.length(), c, used)) {
+      used[cell] = false;
+      return true;
+    }
+  }
+  used[cell] = false;
+  return false;
+}
+
+/**
+ * Checks that isOnBoard(), one word at a time, into a buffer and
+ * in a batch, finds a path spelling every word on the board and
+ * none for the rest.
+ */
+static int testIsOnBoard() {
+  std::mt19937 rng(16);
+  TestLexicon lex = makeTestLexicon(rng);
+  BogglePlayer p;
+
+  p.buildLexicon(lex.words);
+  for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+    TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+    vector<string> probes(lex.words.begin(), lex.words.end());
+    vector< vector<int> > paths;
+    vector<unsigned int> buffer(board.rows * board.cols);
+
+    probes.push_back("");
+    probes.push_back("qu");
+    probes.push_back("q");
+    p.setBoard(board.rows, board.cols, board.dice());
+    p.isOnBoard(probes.data(), probes.size(), &paths);
+    if(paths.size() != probes.size()) {
+      std::cerr << "Apparent problem with isOnBoard #3." << std::endl;
+      return -1;
+    }
+
+    for(unsigned int i = 0; i < probes.size(); i++) {
+      vector<bool> used(board.rows * board.cols, false);
+      vector<int> path = p.isOnBoard(probes[i]);
+      unsigned int n = p.isOnBoard(probes[i], buffer.data());
+      vector<unsigned int> cells(path.begin(), path.end());
+      bool on = false;
+      for(unsigned int c = 0; c < board.rows * board.cols && !on && !probes[i].empty(); c++) {
+        on = spellFrom(board, probes[i], 0, c, used);
+      }
+      if(on != !path.empty() || (on && !validPath(board, probes[i], cells.data(), cells.size()))) {
+        std::cerr << "Apparent problem with isOnBoard #4." << std::endl;
+        return -1;
+      }
+      if(n != path.size() || !std::equal(path.begin(), path.end(), buffer.begin())
+         || paths[i] != path) {
+        std::cerr << "Apparent problem with isOnBoard #5." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Returns every word a search passed to a WordPaths, with its path.
+ */
+static std::map< string, vector<unsigned int> > pathMap(const WordPaths& found) {
+  std::map< string, vector<unsigned int> > words;
+  for(unsigned int w = 0; w < found.size(); w++) {
+    words[string(found.wordData(w), found.wordLength(w))].assign(
+      found.path(w), found.path(w) + found.pathLength(w));
+  }
+  return words;
+}
+
+/**
+ * Checks that scanning the lexicon and walking the board find the
+ * same words with the same paths, on boards with blank and
+ * several-letter faces as well, and that the automatic choice
+ * agrees with both.
+ */
+static int testScan() {
+  std::mt19937 rng(18);
+  TestLexicon lex = makeTestLexicon(rng);
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer walk, scan, automatic;
+    if(t == 1) {
+      walk.setLexiconType(DAWG_LEXICON);
+      scan.setLexiconType(DAWG_LEXICON);
+      automatic.setLexiconType(DAWG_LEXICON);
+    }
+    walk.buildLexicon(lex.words);
+    scan.buildLexicon(lex.words);
+    automatic.buildLexicon(lex.words);
+    walk.setSolveStrategy(BOARD_STRATEGY);
+    scan.setSolveStrategy(LEXICON_STRATEGY);
+
+    for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+      for(unsigned int b = 0; b < 3; b++) {
+        TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+        WordPaths walked, scanned, chosen;
+        if(b == 1) board.faces[rng() % board.faces.size()] = "";
+        if(b == 2) board.faces[rng() % board.faces.size()] = "rs";
+        walk.setBoard(board.rows, board.cols, board.dice());
+        scan.setBoard(board.rows, board.cols, board.dice());
+        automatic.setBoard(board.rows, board.cols, board.dice());
+        walk.getAllValidWords(0, &walked);
+        scan.getAllValidWords(0, &scanned);
+        automatic.getAllValidWords(0, &chosen);
+        if(pathMap(walked) != pathMap(scanned) || pathMap(walked) != pathMap(chosen)) {
+          std::cerr << "Apparent problem with the lexicon scan #1." << std::endl;
+          return -1;
+        }
+        if(b == 0 && pathMap(walked).size() != solveTestBoard(board, lex, 0).size()) {
+          std::cerr << "Apparent problem with the lexicon scan #2." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that solveBatch() finds, on every board of a batch, the
+ * words, count and score that setBoard() and getAllValidWords()
+ * find one board at a time, with one thread or several.
+ */
+static int testBatch() {
+  std::mt19937 rng(20);
+  TestLexicon lex = makeTestLexicon(rng);
+  vector<TestBoard> boards;
+  BoardBatch batch;
+
+  // several chunks of boards, so the threads share them out
+  for(unsigned int b = 0; b < 300; b++) {
+    const unsigned int* shape = TEST_SHAPES[b % TEST_SHAPE_COUNT];
+    boards.push_back(rollTestBoard(shape[0], shape[1], rng));
+    batch.add(shape[0], shape[1], boards.back().dice());
+  }
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer p;
+    BatchResults serial;
+    if(t == 1) p.setLexiconType(DAWG_LEXICON);
+    p.buildLexicon(lex.words);
+    if(!p.solveBatch(batch, 3, &serial, 1, 1)) {
+      std::cerr << "Apparent problem with batches #1." << std::endl;
+      return -1;
+    }
+
+    for(unsigned int b = 0; b < boards.size(); b++) {
+      set<string> words, batched;
+      unsigned int score = 0;
+      p.setBoard(boards[b].rows, boards[b].cols, boards[b].dice());
+      p.getAllValidWords(3, &words);
+      for(set<string>::iterator it = words.begin(); it != words.end(); it++) {
+        score += scoreWord(it->length());
+      }
+      string text(&serial.text[0] + serial.textStart[b], &serial.text[0] + serial.textStart[b+1]);
+      for(size_t start = 0, end; start < text.length(); start = end + 1) {
+        end = text.find('\n', start);
+        batched.insert(text.substr(start, end - start));
+      }
+      if(serial.counts[b] != words.size() || serial.scores[b] != score || batched != words) {
+        std::cerr << "Apparent problem with batches #2." << std::endl;
+        return -1;
+      }
+    }
+
+    for(unsigned int threads = 2; threads <= 5; threads += 3) {
+      BatchResults threaded;
+      p.solveBatch(batch, 3, &threaded, 1, threads);
+      if(threaded.counts != serial.counts || threaded.scores != serial.scores
+         || threaded.text != serial.text || threaded.textStart != serial.textStart) {
+        std::cerr << "Apparent problem with batches #3." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that after every one of many random updateCell() calls,
+ * getAllValidWords() gives the same words with the same paths as
+ * setBoard() and a fresh search of the changed board.
+ */
+static int testUpdateCell() {
+  std::mt19937 rng(21);
+  TestLexicon lex = makeTestLexicon(rng);
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer updated, fresh;
+    if(t == 1) {
+      updated.setLexiconType(DAWG_LEXICON);
+      fresh.setLexiconType(DAWG_LEXICON);
+    }
+    updated.buildLexicon(lex.words);
+    fresh.buildLexicon(lex.words);
+
+    for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+      TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+      updated.setBoard(board.rows, board.cols, board.dice());
+
+      for(unsigned int change = 0; change < 60; change++) {
+        WordPaths incremental, full;
+        unsigned int cell = rng() % board.faces.size();
+        unsigned int min = rng() % 4;
+        // now and then a blank die
+        board.faces[cell] = rng() % 10 == 0 ? "" : TEST_FACES[rng() % TEST_FACE_COUNT];
+        if(!updated.updateCell(cell / board.cols, cell % board.cols, board.faces[cell])) {
+          std::cerr << "Apparent problem with updateCell #1." << std::endl;
+          return -1;
+        }
+        fresh.setBoard(board.rows, board.cols, board.dice());
+        updated.getAllValidWords(min, &incremental);
+        fresh.getAllValidWords(min, &full);
+        if(pathMap(incremental) != pathMap(full)) {
+          std::cerr << "Apparent problem with updateCell #2." << std::endl;
+          return -1;
+        }
+      }
+      if(updated.updateCell(board.rows, 0, "a") || updated.updateCell(0, board.cols, "a")) {
+        std::cerr << "Apparent problem with updateCell #3." << std::endl;
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Returns a board turned and mirrored by one of the 8 symmetries
+ * of a rectangle: bit 2 swaps rows and columns, then bits 0 and 1
+ * reverse the rows and the columns.
+ */
+static TestBoard turnTestBoard(const TestBoard& board, unsigned int symmetry) {
+  TestBoard turned((symmetry & 4) ? board.cols : board.rows,
+                   (symmetry & 4) ? board.rows : board.cols);
+  for(unsigned int i = 0; i < turned.rows; i++) {
+    for(unsigned int j = 0; j < turned.cols; j++) {
+      unsigned int r = (symmetry & 4) ? j : i, c = (symmetry & 4) ? i : j;
+      if(symmetry & 1) r = board.rows - 1 - r;
+      if(symmetry & 2) c = board.cols - 1 - c;
+      turned.faces[i * turned.cols + j] = board.faces[r * board.cols + c];
+    }
+  }
+  return turned;
+}
+
+/**
+ * Checks that a board solved once is answered from the result
+ * cache in each of its 8 turns and mirrors, with the words a
+ * search of the turned board finds and paths spelling them on it.
+ */
+static int testResultCache() {
+  std::mt19937 rng(22);
+  TestLexicon lex = makeTestLexicon(rng);
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer cached, direct;
+    if(t == 1) {
+      cached.setLexiconType(DAWG_LEXICON);
+      direct.setLexiconType(DAWG_LEXICON);
+    }
+    cached.buildLexicon(lex.words);
+    direct.buildLexicon(lex.words);
+    cached.setResultCache(16);
+
+    for(unsigned int s = 0; s < TEST_SHAPE_COUNT; s++) {
+      TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+      set<string> words;
+      cached.setBoard(board.rows, board.cols, board.dice());
+      cached.getAllValidWords(0, &words);
+
+      for(unsigned int symmetry = 0; symmetry < 8; symmetry++) {
+        TestBoard turned = turnTestBoard(board, symmetry);
+        unsigned int min = symmetry % 4;
+        unsigned long long hits = cached.cacheHits();
+        WordPaths found;
+        set<string> expected, seen;
+        direct.setBoard(turned.rows, turned.cols, turned.dice());
+        direct.getAllValidWords(min, &expected);
+        cached.setBoard(turned.rows, turned.cols, turned.dice());
+        cached.getAllValidWords(min, &found);
+        if(cached.cacheHits() != hits + 1) {
+          std::cerr << "Apparent problem with the result cache #1." << std::endl;
+          return -1;
+        }
+        for(unsigned int w = 0; w < found.size(); w++) {
+          string word(found.wordData(w), found.wordLength(w));
+          seen.insert(word);
+          if(!validPath(turned, word, found.path(w), found.pathLength(w))) {
+            std::cerr << "Apparent problem with the result cache #2." << std::endl;
+            return -1;
+          }
+        }
+        if(seen != expected || found.size() != expected.size()) {
+          std::cerr << "Apparent problem with the result cache #3." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Judges whether the faces from a cell on can each be shown by a
+ * die of its own among those not yet used.
+ */
+static bool placeDice(const vector<string>& faces, const DiceFaces& dice,
+                      unsigned int cell, vector<bool>& used) {
+  if(cell == faces.size()) return true;
+  for(unsigned int d = 0; d < dice.size(); d++) {
+    if(used[d] || std::find(dice[d].begin(), dice[d].end(), faces[cell]) == dice[d].end()) continue;
+    used[d] = true;
+    if(placeDice(faces, dice, cell + 1, used)) return true;
+    used[d] = false;
+  }
+  return false;
+}
+
+/**
+ * Checks that annealing with a step budget finds the same boards,
+ * with the same scores, solves and kept moves, on one thread as on
+ * several, that each board keeps to the dice and scores what a
+ * search of it gives, and that dice which cannot be rolled or a
+ * board without cells are refused.
+ */
+static int testAnneal() {
+  std::mt19937 rng(24);
+  TestLexicon lex = makeTestLexicon(rng);
+  DiceFaces dice = standardDice();
+  AnnealReport reports[3];
+  BogglePlayer p;
+  vector<WordRef> refs;
+  TST tst;
+
+  p.buildLexicon(lex.words);
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    WordRef ref = {it->data(), (unsigned int)it->length()};
+    refs.push_back(ref);
+  }
+  tst.build(refs.data(), refs.size());
+  for(unsigned int r = 0; r < 3; r++) {
+    AnnealSettings settings;
+    settings.seconds = 1e6;
+    settings.steps = 400;
+    settings.chains = 5;
+    settings.threads = 1 + 2 * r;
+    settings.seed = 24;
+    if(!p.annealBoards(settings, &reports[r]) || reports[r].best.empty()) {
+      std::cerr << "Apparent problem with annealBoards #1." << std::endl;
+      return -1;
+    }
+  }
+
+  for(unsigned int r = 1; r < 3; r++) {
+    if(reports[r].solves != reports[0].solves || reports[r].accepted != reports[0].accepted
+       || reports[r].best.size() != reports[0].best.size()) {
+      std::cerr << "Apparent problem with annealBoards #2." << std::endl;
+      return -1;
+    }
+    for(unsigned int b = 0; b < reports[0].best.size(); b++) {
+      if(reports[r].best[b].faces != reports[0].best[b].faces
+         || reports[r].best[b].score != reports[0].best[b].score
+         || reports[r].best[b].words != reports[0].best[b].words) {
+        std::cerr << "Apparent problem with annealBoards #3." << std::endl;
+        return -1;
+      }
+    }
+  }
+
+  for(unsigned int b = 0; b < reports[0].best.size(); b++) {
+    const AnnealBoard& best = reports[0].best[b];
+    TestBoard board(4, 4);
+    set<string> words;
+    unsigned int score = 0;
+    vector<bool> used(dice.size(), false);
+    board.faces = best.faces;
+    p.setBoard(4, 4, board.dice());
+    p.getAllValidWords(3, &words);
+    for(set<string>::iterator it = words.begin(); it != words.end(); it++) {
+      score += scoreWord(it->length());
+    }
+    if(!placeDice(best.faces, dice, 0, used)) {
+      std::cerr << "Apparent problem with annealBoards #4." << std::endl;
+      return -1;
+    }
+    if(words.size() != best.words || score != best.score) {
+      std::cerr << "Apparent problem with annealBoards #5." << std::endl;
+      return -1;
+    }
+  }
+
+  // a die without faces, a face too long to pack and an empty
+  // board are refused, leaving the report empty, and a face of the
+  // longest length is not
+  for(unsigned int c = 0; c < 4; c++) {
+    AnnealSettings settings;
+    AnnealReport report = reports[0];
+    settings.dice = dice;
+    settings.seconds = 1e6;
+    settings.steps = 10;
+    settings.chains = 1;
+    settings.threads = 1;
+    if(c == 0) settings.dice[3].clear();
+    if(c == 1) settings.dice[5][2] = string(BoardBatch::MAX_FACE + 1, 'e');
+    if(c == 2) settings.rows = 0;
+    if(c == 3) settings.dice[5][2] = string(BoardBatch::MAX_FACE, 'e');
+    if(p.annealBoards(settings, &report) != (c == 3)) {
+      std::cerr << "Apparent problem with annealBoards #6." << std::endl;
+      return -1;
+    }
+    annealBoards(tst, settings, &report);
+    if(report.best.empty() != (c < 3) || (report.solves == 0) != (c < 3)) {
+      std::cerr << "Apparent problem with annealBoards #7." << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that attachLexicon() refuses a snapshot with a TST child
+ * index or a DAWG edge target past the last entry, or a last DAWG
+ * state that runs off the end, and keeps the lexicon it had.
+ */
+static int testCorruptSnapshot() {
+  static const char* const PATH = "bogtest.snapshot";
+  // an edge packs its label, end and last bits below its target
+  const unsigned int LAST_EDGE = 1u << 9, TARGET_SHIFT = 10;
+  std::mt19937 rng(5);
+  TestLexicon lex = makeTestLexicon(rng);
+  set<string> kept;
+
+  kept.insert("kept");
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer saved;
+    vector<char> file;
+    SnapshotHeader header;
+    if(t == 1) saved.setLexiconType(DAWG_LEXICON);
+    saved.buildLexicon(lex.words);
+    if(saved.saveLexicon(PATH)) {
+      std::ifstream in(PATH, std::ios::binary);
+      file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    if(file.size() < sizeof header) {
+      remove(PATH);
+      std::cerr << "Apparent problem with corrupt snapshots #1." << std::endl;
+      return -1;
+    }
+    memcpy(&header, file.data(), sizeof header);
+
+    // case 0 is the file as written, the others each break one index
+    for(unsigned int c = 0; c < 5; c++) {
+      vector<char> broken = file;
+      BogglePlayer p;
+      unsigned int entry = rng() % header.count, value;
+      char* at = &broken[sizeof header + (size_t)entry * header.entrySize];
+      if(t == 0 && c > 0) {
+        static const size_t FIELDS[] = {
+          offsetof(TSTNode<char>, left), offsetof(TSTNode<char>, middle),
+          offsetof(TSTNode<char>, right), offsetof(TSTNode<char>, left)
+        };
+        value = c == 4 ? ~0u : header.count;
+        memcpy(at + FIELDS[c - 1], &value, sizeof value);
+      }
+      if(t == 1 && c > 0) {
+        if(c == 4) at = &broken[broken.size() - sizeof value];
+        memcpy(&value, at, sizeof value);
+        if(c == 4) {
+          value &= ~LAST_EDGE;
+        }
+        else {
+          // targets of count - 1, the last edge, then count and past it
+          value &= (1u << TARGET_SHIFT) - 1;
+          value |= (header.count - 2 + c) << TARGET_SHIFT;
+        }
+        memcpy(at, &value, sizeof value);
+      }
+      {
+        std::ofstream out(PATH, std::ios::binary);
+        out.write(broken.data(), broken.size());
+      }
+      p.buildLexicon(kept);
+      bool valid = c == 0 || (t == 1 && c == 1);
+      if(p.attachLexicon(PATH) != valid || p.isInLexicon("kept") == valid) {
+        remove(PATH);
+        std::cerr << "Apparent problem with corrupt snapshots #2." << std::endl;
+        return -1;
+      }
+    }
+  }
+  remove(PATH);
+  return 0;
+}
+
+/**
+ * Checks that WordList::read() and loadLexicon() take a file of
+ * shuffled, mixed-case, repeated words, with CRLF line ends, blank
+ * lines and no final line end, as its distinct lowercased words in
+ * sorted order, and that a missing file is refused.
+ */
+static int testWordListFile() {
+  static const char* const PATH = "bogtest.words";
+  std::mt19937 rng(6);
+  TestLexicon lex = makeTestLexicon(rng);
+  vector<string> expected(lex.words.begin(), lex.words.end());
+  vector<string> lines(expected);
+  string text;
+  WordList list, empty;
+  bool ok;
+
+  // every word again in upper case
+  for(unsigned int i = 0; i < expected.size(); i++) {
+    string upper = expected[i];
+    for(unsigned int k = 0; k < upper.length(); k++) upper[k] = toupper(upper[k]);
+    lines.push_back(upper);
+  }
+  std::shuffle(lines.begin(), lines.end(), rng);
+  for(unsigned int i = 0; i < lines.size(); i++) {
+    unsigned int end = rng() % 4;
+    text += lines[i];
+    if(i + 1 < lines.size()) text += end == 0 ? "\r\n" : end == 1 ? "\n\n" : "\n";
+  }
+  {
+    std::ofstream out(PATH, std::ios::binary);
+    out << text;
+  }
+
+  ok = list.read(PATH);
+  if(!ok || list.refs.size() != expected.size()) {
+    remove(PATH);
+    std::cerr << "Apparent problem with word files #1." << std::endl;
+    return -1;
+  }
+  for(unsigned int i = 0; i < expected.size(); i++) {
+    if(string(list.refs[i].data, list.refs[i].length) != expected[i]) {
+      remove(PATH);
+      std::cerr << "Apparent problem with word files #2." << std::endl;
+      return -1;
+    }
+  }
+
+  for(unsigned int t = 0; t < 2; t++) {
+    BogglePlayer p;
+    if(t == 1) p.setLexiconType(DAWG_LEXICON);
+    ok = p.loadLexicon(PATH);
+    for(set<string>::iterator it = lex.prefixes.begin(); ok && it != lex.prefixes.end(); it++) {
+      ok = p.isInLexicon(*it) == (lex.words.count(*it) == 1);
+    }
+    if(!ok) {
+      remove(PATH);
+      std::cerr << "Apparent problem with word files #3." << std::endl;
+      return -1;
+    }
+  }
+
+  {
+    std::ofstream out(PATH, std::ios::binary);
+  }
+  ok = empty.read(PATH) && empty.refs.empty();
+  remove(PATH);
+  if(!ok || list.read(PATH)) {
+    std::cerr << "Apparent problem with word files #4." << std::endl;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Returns a version of a LexiconHandle whose lexicon holds the one
+ * word "v" and its serial, and whose word count is that serial.
+ */
+static LexiconVersion* makeTestVersion(unsigned int serial) {
+  LexiconVersion* version = new LexiconVersion();
+  version->tst.insert("v" + std::to_string(serial));
+  version->words = serial;
+  return version;
+}
+
+/**
+ * Checks that readers pinning a LexiconHandle while a writer
+ * publishes version after version always see one whole version,
+ * never one older than the last they saw, and that a writer which
+ * finds every slot pinned waits for a reader to let one go.
+ */
+static int testLexiconPublish() {
+  const unsigned int VERSIONS = 2000, READERS = 3;
+  LexiconHandle handle;
+  std::atomic<bool> done(false), broken(false), published(false);
+  vector<std::thread> readers;
+
+  handle.publish(makeTestVersion(1));
+  for(unsigned int r = 0; r < READERS; r++) {
+    readers.push_back(std::thread([&]() {
+      unsigned int last = 0;
+      while(!done) {
+        LexiconHandle::Reader reader(handle);
+        unsigned int serial = reader->words;
+        if(serial < last || !reader->lexicon->find("v" + std::to_string(serial))
+           || reader->lexicon->find("v" + std::to_string(serial + 1))) {
+          broken = true;
+        }
+        last = serial;
+      }
+    }));
+  }
+  for(unsigned int v = 2; v <= VERSIONS; v++) {
+    handle.publish(makeTestVersion(v));
+  }
+  done = true;
+  for(unsigned int r = 0; r < READERS; r++) readers[r].join();
+  if(broken) {
+    std::cerr << "Apparent problem with lexicon publishing #1." << std::endl;
+    return -1;
+  }
+
+  // pin a version in every slot, so the next writer has to wait
+  vector<LexiconHandle::Reader*> pinned;
+  pinned.push_back(new LexiconHandle::Reader(handle));
+  for(unsigned int v = 1; v < LexiconHandle::SLOTS; v++) {
+    handle.publish(makeTestVersion(VERSIONS + v));
+    pinned.push_back(new LexiconHandle::Reader(handle));
+  }
+  std::thread writer([&]() {
+    handle.publish(makeTestVersion(VERSIONS + LexiconHandle::SLOTS));
+    published = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  bool waited = !published;
+  // the oldest is replaced already, so letting it go frees its slot
+  delete pinned[0];
+  writer.join();
+  {
+    LexiconHandle::Reader reader(handle);
+    if(!waited || reader->words != VERSIONS + LexiconHandle::SLOTS) {
+      for(unsigned int i = 1; i < pinned.size(); i++) delete pinned[i];
+      std::cerr << "Apparent problem with lexicon publishing #2." << std::endl;
+      return -1;
+    }
+  }
+  for(unsigned int i = 1; i < pinned.size(); i++) delete pinned[i];
+  return 0;
+}
+
+/**
+ * Checks that batched lookups agree with single ones on batches of
+ * every size around the number of lookups kept in flight, over
+ * shuffled words, prefixes, misses, repeats and empty strings, in
+ * the TST and the DAWG and in an empty lexicon.
+ */
+static int testFindMany() {
+  // around one, two and three times the lookups in flight
+  static const unsigned int SIZES[] = {0, 1, 2, 15, 16, 17, 31, 32, 33, 47, 48, 49, 500};
+  std::mt19937 rng(9);
+  TestLexicon lex = makeTestLexicon(rng);
+  vector<string> probes;
+
+  for(set<string>::iterator it = lex.prefixes.begin(); it != lex.prefixes.end(); it++) {
+    probes.push_back(*it);
+    if(rng() % 4 == 0) probes.push_back(*it + "q");
+    if(rng() % 8 == 0) probes.push_back(*it);
+    if(rng() % 16 == 0) probes.push_back("");
+  }
+  std::shuffle(probes.begin(), probes.end(), rng);
+
+  for(unsigned int t = 0; t < 3; t++) {
+    BogglePlayer p;
+    if(t == 1) p.setLexiconType(DAWG_LEXICON);
+    if(t < 2) p.buildLexicon(lex.words);
+    for(unsigned int s = 0; s < sizeof SIZES / sizeof SIZES[0]; s++) {
+      unsigned int start = rng() % (probes.size() - SIZES[s]);
+      // stale results of a longer batch, which must not survive
+      vector<bool> hits(SIZES[s] + 7, 1);
+      p.isInLexicon(probes.data() + start, SIZES[s], &hits);
+      if(hits.size() != SIZES[s]) {
+        std::cerr << "Apparent problem with batched lookups #1." << std::endl;
+        return -1;
+      }
+      for(unsigned int i = 0; i < SIZES[s]; i++) {
+        const string& probe = probes[start + i];
+        bool word = t < 2 && lex.words.count(probe) == 1;
+        if(hits[i] != word || p.isInLexicon(probe) != word) {
+          std::cerr << "Apparent problem with batched lookups #2." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that one SearchSet, kept across boards of every shape
+ * assigned in turn to one BoardGrid, finds the same words along
+ * the same paths and in the same order as the generic search, for
+ * the fixed 4x4 and 5x5 searches and the fallback alike, in the
+ * TST and the DAWG.
+ */
+static int testFixedSearch() {
+  std::mt19937 rng(19);
+  TestLexicon lex = makeTestLexicon(rng);
+  vector<WordRef> refs;
+  TST tst;
+  DAWG dawg;
+  DAWGBuilder builder(&dawg);
+  BoardGrid grid;
+  WordPaths fixed;
+  SearchSet<TST> tstSearches(grid, tst, 0, &fixed);
+  SearchSet<DAWG> dawgSearches(grid, dawg, 0, &fixed);
+
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    WordRef ref = {it->data(), (unsigned int)it->length()};
+    refs.push_back(ref);
+    builder.add(it->data(), it->length());
+  }
+  tst.build(refs.data(), refs.size());
+  if(!builder.finish()) {
+    std::cerr << "Apparent problem with fixed searches #1." << std::endl;
+    return -1;
+  }
+
+  for(unsigned int b = 0; b < 60; b++) {
+    // mostly the fixed shapes, in no order, with the others between
+    bool other = rng() % 4 == 0;
+    unsigned int s = rng() % TEST_SHAPE_COUNT;
+    unsigned int rows = other ? TEST_SHAPES[s][0] : 4 + rng() % 2;
+    unsigned int cols = other ? TEST_SHAPES[s][1] : rows;
+    unsigned int min = rng() % 5;
+    TestBoard board = rollTestBoard(rows, cols, rng);
+    set<string> expected = solveTestBoard(board, lex, min);
+    grid.assign(board.rows, board.cols, board.dice());
+
+    for(unsigned int t = 0; t < 2; t++) {
+      WordPaths generic;
+      set<string> words;
+      fixed.clear();
+      if(t == 0) {
+        tstSearches.bind(min, &fixed);
+        tstSearches.search();
+        searchGrid(grid, tst, min, &generic);
+      }
+      else {
+        dawgSearches.bind(min, &fixed);
+        dawgSearches.search();
+        searchGrid(grid, dawg, min, &generic);
+      }
+      for(unsigned int w = 0; w < fixed.size(); w++) {
+        words.insert(string(fixed.wordData(w), fixed.wordLength(w)));
+      }
+      if(words != expected || fixed.size() != generic.size()) {
+        std::cerr << "Apparent problem with fixed searches #2." << std::endl;
+        return -1;
+      }
+      for(unsigned int w = 0; w < fixed.size(); w++) {
+        if(string(fixed.wordData(w), fixed.wordLength(w))
+           != string(generic.wordData(w), generic.wordLength(w))
+           || fixed.pathLength(w) != generic.pathLength(w)
+           || !std::equal(fixed.path(w), fixed.path(w) + fixed.pathLength(w),
+                          generic.path(w))) {
+          std::cerr << "Apparent problem with fixed searches #3." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that advancing a cursor through a word in pieces of any
+ * length, and from copies of one cursor down every branch, agrees
+ * with what the TST, compacted or not, and the DAWG hold as words
+ * and prefixes.
+ */
+static int testCursor() {
+  std::mt19937 rng(3);
+  TestLexicon lex = makeTestLexicon(rng);
+  vector<WordRef> refs;
+  vector<string> probes;
+  TST tst, compacted;
+  DAWG dawg;
+  DAWGBuilder builder(&dawg);
+
+  for(unsigned int i = 0; i < NON_ASCII_WORDS; i++) {
+    lex.words.insert(NON_ASCII[i]);
+    for(unsigned int k = 1; k <= strlen(NON_ASCII[i]); k++) {
+      lex.prefixes.insert(string(NON_ASCII[i], k));
+    }
+  }
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    WordRef ref = {it->data(), (unsigned int)it->length()};
+    refs.push_back(ref);
+    builder.add(it->data(), it->length());
+  }
+  tst.build(refs.data(), refs.size());
+  compacted.build(refs.data(), refs.size());
+  compacted.compact();
+  if(!builder.finish()) {
+    std::cerr << "Apparent problem with cursors #1." << std::endl;
+    return -1;
+  }
+
+  for(set<string>::iterator it = lex.prefixes.begin(); it != lex.prefixes.end(); it++) {
+    probes.push_back(*it);
+    probes.push_back(*it + "q");
+    probes.push_back(*it + "\xc3");
+  }
+  for(unsigned int i = 0; i < probes.size(); i++) {
+    const string& probe = probes[i];
+    bool prefix = lex.prefixes.count(probe) == 1, word = lex.words.count(probe) == 1;
+    LexiconCursor cursors[3];
+    bool ok[3] = {true, true, true};
+    // pieces of 0 to 3 characters, as dice faces advance the search
+    for(unsigned int pos = 0; pos < probe.length(); ) {
+      unsigned int n = std::min((unsigned int)(rng() % 4), (unsigned int)probe.length() - pos);
+      ok[0] = ok[0] && tst.advance(cursors[0], probe.data() + pos, n);
+      ok[1] = ok[1] && compacted.advance(cursors[1], probe.data() + pos, n);
+      ok[2] = ok[2] && dawg.advance(cursors[2], probe.data() + pos, n);
+      pos += n;
+    }
+    for(unsigned int c = 0; c < 3; c++) {
+      if(ok[c] != prefix || (prefix && cursors[c].end != word)) {
+        std::cerr << "Apparent problem with cursors #2." << std::endl;
+        return -1;
+      }
+    }
+    if(!prefix) continue;
+
+    // a search copies the cursor of a path for every neighbour
+    for(unsigned int b = 0; b < 27; b++) {
+      string next = probe + (char)(b < 26 ? 'a' + b : '\xc3');
+      LexiconCursor branches[3] = {cursors[0], cursors[1], cursors[2]};
+      bool expected = lex.prefixes.count(next) == 1;
+      if(tst.advance(branches[0], &next[probe.length()], 1) != expected
+         || compacted.advance(branches[1], &next[probe.length()], 1) != expected
+         || dawg.advance(branches[2], &next[probe.length()], 1) != expected) {
+        std::cerr << "Apparent problem with cursors #3." << std::endl;
+        return -1;
+      }
+      for(unsigned int c = 0; expected && c < 3; c++) {
+        if(branches[c].end != (lex.words.count(next) == 1)) {
+          std::cerr << "Apparent problem with cursors #4." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Checks that one player, given boards of shapes growing,
+ * shrinking and repeating, with faces longer than a short string
+ * holds and in any case, solves each as if it were its first, and
+ * finds a path for each of its words, across lexicon rebuilds and
+ * with and without the board filter.
+ */
+static int testBoardReuse() {
+  static const char* const LONG_FACE = "SupercalifragilisticExpiali";
+  std::mt19937 rng(23);
+  TestLexicon lex = makeTestLexicon(rng);
+  BogglePlayer p;
+  string longWord = LONG_FACE;
+
+  for(unsigned int k = 0; k < longWord.length(); k++) longWord[k] = tolower(longWord[k]);
+  lex.words.insert(longWord);
+  lex.words.insert(longWord + "ab");
+  for(unsigned int k = 1; k <= longWord.length() + 2; k++) {
+    lex.prefixes.insert((longWord + "ab").substr(0, k));
+  }
+  p.buildLexicon(lex.words);
+
+  for(unsigned int b = 0; b < 80; b++) {
+    unsigned int s = rng() % TEST_SHAPE_COUNT;
+    TestBoard board = rollTestBoard(TEST_SHAPES[s][0], TEST_SHAPES[s][1], rng);
+    for(unsigned int c = 0; c < board.rows * board.cols; c++) {
+      unsigned int roll = rng() % 8;
+      if(roll == 0) board.faces[c] = LONG_FACE;
+      if(roll == 1) {
+        for(unsigned int k = 0; k < board.faces[c].length(); k++) {
+          board.faces[c][k] = toupper(board.faces[c][k]);
+        }
+      }
+    }
+    // half the boards are set twice, into storage of their own shape
+    for(unsigned int again = 0; again < 1 + rng() % 2; again++) {
+      set<string> expected = solveTestBoard(board, lex, 2), words;
+      if(b == 40 && again == 0) {
+        p.setLexiconType(DAWG_LEXICON);
+        p.buildLexicon(lex.words);
+      }
+      p.setBoardFilter(rng() % 2);
+      p.setBoard(board.rows, board.cols, board.dice());
+      if(!p.getAllValidWords(2, &words) || words != expected) {
+        std::cerr << "Apparent problem with board reuse #1." << std::endl;
+        return -1;
+      }
+      for(set<string>::iterator it = words.begin(); it != words.end(); it++) {
+        vector<int> path = p.isOnBoard(*it);
+        vector<unsigned int> cells(path.begin(), path.end());
+        if(!validPath(board, *it, cells.data(), cells.size())) {
+          std::cerr << "Apparent problem with board reuse #2." << std::endl;
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * The generator sampleBoards() rolls a block of boards with,
+ * xoshiro256** seeded through splitmix64 from a seed and the
+ * block, written out again to rebuild its boards.
+ */
+struct TestRandom {
+  unsigned long long s[4];
+
+  static unsigned long long split(unsigned long long& x) {
+    unsigned long long z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  TestRandom(unsigned long long seed, unsigned long long block) {
+    unsigned long long x = seed;
+    x = split(x) ^ block;
+    for(int k = 0; k < 4; k++) s[k] = split(x);
+  }
+
+  unsigned long long next() {
+    unsigned long long r = s[1] * 5;
+    unsigned long long result = ((r << 7) | (r >> 57)) * 9;
+    unsigned long long t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+  }
+
+  unsigned int below(unsigned int n) {
+    return (unsigned int)(((next() >> 32) * n) >> 32);
+  }
+};
+
+/**
+ * Judges whether two histograms counted the same values.
+ */
+static bool sameHistogram(const Histogram& a, const Histogram& b) {
+  if(a.samples() != b.samples() || a.size() != b.size()) return false;
+  for(unsigned int v = 0; v < a.size(); v++) {
+    if(a.count(v) != b.count(v)) return false;
+  }
+  return true;
+}
+
+/**
+ * Checks that sampling gives the same histograms on any number of
+ * threads, that they count every board, and that they match the
+ * words getAllValidWords() finds on the same boards, rolled again
+ * from the generator of each block, with the dice in order and
+ * shuffled; and that dice which cannot be rolled sample nothing.
+ */
+static int testSampleBoards() {
+  // one block and a part of another
+  const unsigned int BLOCK = 4096, SAMPLES = 5000;
+  std::mt19937 rng(25);
+  TestLexicon lex = makeTestLexicon(rng);
+  DiceFaces dice = standardDice();
+  BogglePlayer p;
+  vector<WordRef> refs;
+  TST tst;
+
+  p.buildLexicon(lex.words);
+  for(set<string>::iterator it = lex.words.begin(); it != lex.words.end(); it++) {
+    WordRef ref = {it->data(), (unsigned int)it->length()};
+    refs.push_back(ref);
+  }
+  tst.build(refs.data(), refs.size());
+  // fewer dice than cells, so some cells share a die
+  dice.resize(11);
+  dice[4].push_back("Qu");
+
+  for(unsigned int shuffle = 0; shuffle < 2; shuffle++) {
+    SampleSettings settings;
+    SampleReport reports[3], expected;
+    settings.dice = dice;
+    settings.rows = 3 + shuffle;
+    settings.cols = 5;
+    settings.samples = SAMPLES;
+    settings.shuffle = shuffle;
+    settings.seed = 25 + shuffle;
+
+    for(unsigned int r = 0; r < 3; r++) {
+      settings.threads = 1 + r;
+      if(!p.sampleBoards(settings, &reports[r]) || reports[r].samples != SAMPLES
+         || reports[r].words.samples() != SAMPLES || reports[r].scores.samples() != SAMPLES
+         || reports[r].longest.samples() != SAMPLES) {
+        std::cerr << "Apparent problem with sampleBoards #1." << std::endl;
+        return -1;
+      }
+      if(!sameHistogram(reports[r].words, reports[0].words)
+         || !sameHistogram(reports[r].scores, reports[0].scores)
+         || !sameHistogram(reports[r].longest, reports[0].longest)) {
+        std::cerr << "Apparent problem with sampleBoards #2." << std::endl;
+        return -1;
+      }
+    }
+
+    for(unsigned int block = 0; block * BLOCK < SAMPLES; block++) {
+      TestRandom random(settings.seed, block);
+      unsigned int n = settings.rows * settings.cols;
+      vector<unsigned int> die(n);
+      for(unsigned int cell = 0; cell < n; cell++) die[cell] = cell % dice.size();
+      for(unsigned int b = block * BLOCK; b < SAMPLES && b < (block + 1) * BLOCK; b++) {
+        TestBoard board(settings.rows, settings.cols);
+        set<string> words;
+        unsigned int score = 0, longest = 0;
+        if(shuffle) {
+          for(unsigned int cell = n - 1; cell > 0; cell--) {
+            std::swap(die[cell], die[random.below(cell + 1)]);
+          }
+        }
+        for(unsigned int cell = 0; cell < n; cell++) {
+          const vector<string>& sides = dice[die[cell]];
+          board.faces[cell] = sides[random.below(sides.size())];
+        }
+        p.setBoard(board.rows, board.cols, board.dice());
+        p.getAllValidWords(settings.min, &words);
+        for(set<string>::iterator it = words.begin(); it != words.end(); it++) {
+          score += scoreWord(it->length());
+          longest = std::max(longest, (unsigned int)it->length());
+        }
+        expected.words.add(words.size());
+        expected.scores.add(score);
+        expected.longest.add(longest);
+      }
+    }
+    if(!sameHistogram(expected.words, reports[0].words)
+       || !sameHistogram(expected.scores, reports[0].scores)
+       || !sameHistogram(expected.longest, reports[0].longest)) {
+      std::cerr << "Apparent problem with sampleBoards #3." << std::endl;
+      return -1;
+    }
+  }
+
+  // a die without faces, a face too long to pack and an empty
+  // board sample nothing
+  for(unsigned int c = 0; c < 3; c++) {
+    SampleSettings settings;
+    SampleReport report;
+    settings.dice = dice;
+    settings.samples = 100;
+    settings.threads = 1;
+    if(c == 0) settings.dice[3].clear();
+    if(c == 1) settings.dice[5][2] = string(BoardBatch::MAX_FACE + 1, 'e');
+    if(c == 2) settings.cols = 0;
+    if(p.sampleBoards(settings, &report)) {
+      std::cerr << "Apparent problem with sampleBoards #4." << std::endl;
+      return -1;
+    }
+    sampleBoards(tst, settings, &report);
+    if(report.samples != 0 || report.words.samples() != 0) {
+      std::cerr << "Apparent problem with sampleBoards #5." << std::endl;
+      return -1;
+    }
+  }
+  return 0;
+}
 
 int main (int argc, char* argv[]) {
 
@@ -59,6 +1693,28 @@ int main (int argc, char* argv[]) {
   }
 
   delete p;
+
+  if(testNonAscii() != 0) return -1;
+  if(testParallelBuild() != 0) return -1;
+  if(testDawg() != 0) return -1;
+  if(testSnapshotPadding() != 0) return -1;
+  if(testSolveThreads() != 0) return -1;
+  if(testSplitSearch() != 0) return -1;
+  if(testWordPaths() != 0) return -1;
+  if(testIsOnBoard() != 0) return -1;
+  if(testScan() != 0) return -1;
+  if(testBatch() != 0) return -1;
+  if(testUpdateCell() != 0) return -1;
+  if(testResultCache() != 0) return -1;
+  if(testAnneal() != 0) return -1;
+  if(testCorruptSnapshot() != 0) return -1;
+  if(testWordListFile() != 0) return -1;
+  if(testLexiconPublish() != 0) return -1;
+  if(testFindMany() != 0) return -1;
+  if(testFixedSearch() != 0) return -1;
+  if(testCursor() != 0) return -1;
+  if(testBoardReuse() != 0) return -1;
+  if(testSampleBoards() != 0) return -1;
   return 0;
 
 }